@@ -0,0 +1,673 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * ALSA SEQ < - > JACK MIDI bridge
+ *
+ * Copyright (c) 2026 The a2jmidid authors
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ */
+
+/* Measures round trip latency through a2jmidid. Probe note on events go
+ * from a JACK port through a2jmidid to an ALSA sequencer port, which sends
+ * them straight back through a2jmidid to JACK, or the same in reverse. */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <ctype.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <signal.h>
+#include <getopt.h>
+#include <alsa/asoundlib.h>
+#include <jack/jack.h>
+#include <jack/midiport.h>
+
+#define CLIENT_NAME "a2j_latency"
+#define NSEC_PER_SEC ((int64_t)1000*1000*1000)
+
+/* probe ids are carried in note number and a non zero velocity */
+#define PROBE_IDS (128 * 127)
+
+#define COUNT_LIMIT 10000000
+#define RATE_LIMIT 10000        /* Hz */
+#define BUFFER_SIZE_LIMIT 8192  /* frames */
+
+#define CONNECT_TIMEOUT_SECS 5
+#define DRAIN_TIMEOUT_SECS 1
+
+struct latency_test
+{
+  jack_client_t * jack_client;
+  jack_port_t * jack_out;
+  jack_port_t * jack_in;
+  snd_seq_t * seq;
+  int seq_port;
+  bool reverse;                 /* ALSA -> JACK -> ALSA */
+  unsigned int count;
+  unsigned int rate;
+
+  /* forward: jack process sends probes and collects them */
+  jack_nframes_t interval;
+  jack_nframes_t next_send;
+  bool started;
+  unsigned int sent;
+  jack_nframes_t send_frame[PROBE_IDS];
+
+  /* reverse: the main loop sends probes and collects them */
+  int64_t send_nsec[PROBE_IDS];
+
+  int64_t * results;            /* usecs */
+  unsigned int received;
+};
+
+static struct latency_test g_test;
+static bool g_keep_walking = true;
+
+static
+void
+sigint_handler(
+  int i)
+{
+  g_keep_walking = false;
+}
+
+static
+int64_t
+monotonic_nsec(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static
+void
+probe_encode(
+  unsigned int id,
+  unsigned char * note_ptr,
+  unsigned char * velocity_ptr)
+{
+  *note_ptr = id % 128;
+  *velocity_ptr = id / 128 + 1;
+}
+
+static
+bool
+probe_decode(
+  unsigned char status,
+  unsigned char note,
+  unsigned char velocity,
+  unsigned int * id_ptr)
+{
+  if ((status & 0xF0) != 0x90 || velocity == 0)
+  {
+    return false;
+  }
+
+  *id_ptr = (velocity - 1) * 128 + note;
+  return true;
+}
+
+static
+void
+result_add(
+  int64_t usecs)
+{
+  unsigned int received;
+
+  received = __atomic_load_n(&g_test.received, __ATOMIC_RELAXED);
+  if (received < g_test.count)
+  {
+    g_test.results[received] = usecs;
+    __atomic_store_n(&g_test.received, received + 1, __ATOMIC_RELEASE);
+  }
+}
+
+static
+int
+jack_process(
+  jack_nframes_t nframes,
+  void * arg)
+{
+  void * out_buf;
+  void * in_buf;
+  jack_nframes_t cycle_start;
+  jack_midi_event_t event;
+  jack_midi_data_t * data;
+  uint32_t count;
+  uint32_t i;
+  unsigned int id;
+  unsigned int sent;
+
+  cycle_start = jack_last_frame_time(g_test.jack_client);
+  out_buf = jack_port_get_buffer(g_test.jack_out, nframes);
+  in_buf = jack_port_get_buffer(g_test.jack_in, nframes);
+  jack_midi_clear_buffer(out_buf);
+
+  count = jack_midi_get_event_count(in_buf);
+  for (i = 0; i < count; i++)
+  {
+    if (jack_midi_event_get(&event, in_buf, i) != 0 || event.size != 3)
+    {
+      continue;
+    }
+
+    if (g_test.reverse)
+    {
+      /* echo back to ALSA at the same position */
+      data = jack_midi_event_reserve(out_buf, event.time, 3);
+      if (data != NULL)
+      {
+        memcpy(data, event.buffer, 3);
+      }
+    }
+    else if (probe_decode(event.buffer[0], event.buffer[1], event.buffer[2], &id))
+    {
+      result_add(
+        (int64_t)(cycle_start + event.time - g_test.send_frame[id]) * 1000000 /
+        jack_get_sample_rate(g_test.jack_client));
+    }
+  }
+
+  if (g_test.reverse)
+  {
+    return 0;
+  }
+
+  sent = __atomic_load_n(&g_test.sent, __ATOMIC_ACQUIRE);
+  if (sent == g_test.count)
+  {
+    return 0;
+  }
+
+  if (!g_test.started)
+  {
+    g_test.next_send = cycle_start + nframes;
+    g_test.started = true;
+  }
+  else if ((int32_t)(g_test.next_send - cycle_start) < 0)
+  {
+    /* missed cycles, send the overdue probe now */
+    g_test.next_send = cycle_start;
+  }
+
+  while (sent < g_test.count && (int32_t)(g_test.next_send - (cycle_start + nframes)) < 0)
+  {
+    data = jack_midi_event_reserve(out_buf, g_test.next_send - cycle_start, 3);
+    if (data == NULL)
+    {
+      break;
+    }
+
+    id = sent % PROBE_IDS;
+    data[0] = 0x90;
+    probe_encode(id, data + 1, data + 2);
+    g_test.send_frame[id] = g_test.next_send;
+    g_test.next_send += g_test.interval;
+    sent++;
+  }
+  __atomic_store_n(&g_test.sent, sent, __ATOMIC_RELEASE);
+
+  return 0;
+}
+
+static
+void
+jack_shutdown(
+  void * arg)
+{
+  fprintf(stderr, "JACK shutdown notification received.\n");
+  g_keep_walking = false;
+}
+
+/* a2jmidid exports the sequencer port as a pair of JACK ports, wait for them and connect */
+static
+bool
+connect_bridge(void)
+{
+  char pattern[128];
+  const char ** capture;
+  const char ** playback;
+  int client_id;
+  int i;
+  bool ret;
+
+  client_id = snd_seq_client_id(g_test.seq);
+  ret = false;
+
+  for (i = 0; i < CONNECT_TIMEOUT_SECS * 10 && g_keep_walking; i++)
+  {
+    snprintf(pattern, sizeof(pattern), "^a2j:" CLIENT_NAME "( \\[%d\\])? \\(capture\\)", client_id);
+    capture = jack_get_ports(g_test.jack_client, pattern, JACK_DEFAULT_MIDI_TYPE, JackPortIsOutput);
+    snprintf(pattern, sizeof(pattern), "^a2j:" CLIENT_NAME "( \\[%d\\])? \\(playback\\)", client_id);
+    playback = jack_get_ports(g_test.jack_client, pattern, JACK_DEFAULT_MIDI_TYPE, JackPortIsInput);
+
+    if (capture != NULL && playback != NULL)
+    {
+      ret =
+        jack_connect(g_test.jack_client, jack_port_name(g_test.jack_out), playback[0]) == 0 &&
+        jack_connect(g_test.jack_client, capture[0], jack_port_name(g_test.jack_in)) == 0;
+      if (!ret)
+      {
+        fprintf(stderr, "Failed to connect to a2jmidid ports.\n");
+      }
+    }
+
+    jack_free(capture);
+    jack_free(playback);
+
+    if (ret)
+    {
+      return true;
+    }
+
+    usleep(100000);
+  }
+
+  fprintf(stderr, "a2jmidid did not export the " CLIENT_NAME " sequencer port, is it running?\n");
+  return false;
+}
+
+static
+void
+seq_send_probe(
+  unsigned int id)
+{
+  snd_seq_event_t event;
+  unsigned char note;
+  unsigned char velocity;
+
+  probe_encode(id, &note, &velocity);
+  snd_seq_ev_clear(&event);
+  snd_seq_ev_set_noteon(&event, 0, note, velocity);
+  snd_seq_ev_set_source(&event, g_test.seq_port);
+  snd_seq_ev_set_subs(&event);
+  snd_seq_ev_set_direct(&event);
+
+  g_test.send_nsec[id] = monotonic_nsec();
+  snd_seq_event_output_direct(g_test.seq, &event);
+}
+
+static
+void
+seq_input(void)
+{
+  snd_seq_event_t * event;
+  unsigned int id;
+  int64_t now;
+
+  while (snd_seq_event_input(g_test.seq, &event) >= 0)
+  {
+    now = monotonic_nsec();
+
+    if (event->type == SND_SEQ_EVENT_NOTEON)
+    {
+      if (g_test.reverse)
+      {
+        if (probe_decode(0x90, event->data.note.note, event->data.note.velocity, &id))
+        {
+          result_add((now - g_test.send_nsec[id]) / 1000);
+        }
+      }
+      else
+      {
+        /* echo back towards JACK */
+        snd_seq_ev_set_source(event, g_test.seq_port);
+        snd_seq_ev_set_subs(event);
+        snd_seq_ev_set_direct(event);
+        snd_seq_event_output_direct(g_test.seq, event);
+      }
+    }
+
+    if (snd_seq_event_input_pending(g_test.seq, 0) <= 0)
+    {
+      break;
+    }
+  }
+}
+
+static
+void
+run(void)
+{
+  struct pollfd * pfd;
+  int npfd;
+  int64_t next_send;
+  int64_t interval;
+  int64_t now;
+  int64_t done;
+  int timeout;
+  unsigned int sent;
+
+  npfd = snd_seq_poll_descriptors_count(g_test.seq, POLLIN);
+  pfd = alloca(npfd * sizeof(struct pollfd));
+  snd_seq_poll_descriptors(g_test.seq, pfd, npfd, POLLIN);
+
+  interval = NSEC_PER_SEC / g_test.rate;
+  next_send = monotonic_nsec();
+  sent = 0;
+  done = 0;
+
+  while (g_keep_walking && __atomic_load_n(&g_test.received, __ATOMIC_ACQUIRE) < g_test.count)
+  {
+    now = monotonic_nsec();
+
+    if (g_test.reverse)
+    {
+      while (sent < g_test.count && next_send <= now)
+      {
+        seq_send_probe(sent % PROBE_IDS);
+        next_send += interval;
+        sent++;
+      }
+    }
+    else
+    {
+      sent = __atomic_load_n(&g_test.sent, __ATOMIC_ACQUIRE);
+    }
+
+    /* lost probes never come back, stop a while after the last one was sent */
+    if (sent == g_test.count)
+    {
+      if (done == 0)
+      {
+        done = now + DRAIN_TIMEOUT_SECS * NSEC_PER_SEC;
+      }
+      else if (now >= done)
+      {
+        break;
+      }
+    }
+
+    timeout = 10;
+    if (g_test.reverse && sent < g_test.count)
+    {
+      timeout = next_send > now ? (next_send - now) / 1000000 : 0;
+    }
+
+    if (poll(pfd, npfd, timeout) > 0)
+    {
+      seq_input();
+    }
+  }
+}
+
+static
+int
+compare_int64(
+  const void * a,
+  const void * b)
+{
+  int64_t value_a = *(const int64_t *)a;
+  int64_t value_b = *(const int64_t *)b;
+
+  return value_a < value_b ? -1 : value_a > value_b;
+}
+
+static
+void
+report(void)
+{
+  unsigned int received;
+  unsigned int i;
+  int64_t sum;
+  double avg;
+  double variance;
+
+  received = __atomic_load_n(&g_test.received, __ATOMIC_ACQUIRE);
+
+  printf(
+    "%s, %u probes at %u Hz, buffer size %u, sample rate %u\n",
+    g_test.reverse ? "ALSA -> JACK -> ALSA" : "JACK -> ALSA -> JACK",
+    g_test.count,
+    g_test.rate,
+    (unsigned int)jack_get_buffer_size(g_test.jack_client),
+    (unsigned int)jack_get_sample_rate(g_test.jack_client));
+
+  if (received == 0)
+  {
+    printf("no probes came back\n");
+    return;
+  }
+
+  qsort(g_test.results, received, sizeof(int64_t), compare_int64);
+
+  sum = 0;
+  for (i = 0; i < received; i++)
+  {
+    sum += g_test.results[i];
+  }
+  avg = (double)sum / received;
+
+  variance = 0;
+  for (i = 0; i < received; i++)
+  {
+    variance += (g_test.results[i] - avg) * (g_test.results[i] - avg);
+  }
+  variance /= received;
+
+  printf("%u received, %u lost\n", received, g_test.count - received);
+  printf(
+    "round trip: min %lld us, avg %.1f us, p99 %lld us, max %lld us, jitter (std dev) %.1f us\n",
+    (long long)g_test.results[0],
+    avg,
+    (long long)g_test.results[(received - 1) * 99 / 100],
+    (long long)g_test.results[received - 1],
+    sqrt(variance));
+}
+
+static
+bool
+parse_number(
+  const char * option,
+  const char * str,
+  unsigned long min,
+  unsigned long max,
+  unsigned long * value_ptr)
+{
+  char * end;
+  unsigned long value;
+
+  errno = 0;
+  value = strtoul(str, &end, 10);
+  if (!isdigit((unsigned char)str[0]) || *end != 0 || errno != 0 || value < min || value > max)
+  {
+    fprintf(stderr, "Invalid value '%s' for %s, expected a number from %lu to %lu\n", str, option, min, max);
+    return false;
+  }
+
+  *value_ptr = value;
+  return true;
+}
+
+static
+void
+usage(
+  const char * self)
+{
+  fprintf(stderr, "Usage: %s [-r | --reverse] [-n | --count probes] [-f | --rate Hz] [-b | --buffer-size frames] [-j jack-server]\n", self);
+  fprintf(stderr, "Defaults: 1000 probes at 100 Hz, JACK -> ALSA -> JACK\n");
+}
+
+int
+main(
+  int argc,
+  char *argv[])
+{
+  struct option long_opts[] =
+    {
+      { "reverse", 0, 0, 'r' },
+      { "count", 1, 0, 'n' },
+      { "rate", 1, 0, 'f' },
+      { "buffer-size", 1, 0, 'b' },
+      { 0, 0, 0, 0 }
+    };
+  const char * server_name;
+  jack_nframes_t buffer_size;
+  jack_nframes_t old_buffer_size;
+  unsigned long number;
+  jack_status_t status;
+  int option_index;
+  int c;
+  int ret;
+
+  g_test.count = 1000;
+  g_test.rate = 100;
+  server_name = NULL;
+  buffer_size = 0;
+  ret = 1;
+
+  while ((c = getopt_long(argc, argv, "rn:f:b:j:", long_opts, &option_index)) != -1)
+  {
+    switch (c)
+    {
+    case 'r':
+      g_test.reverse = true;
+      break;
+    case 'n':
+      if (!parse_number("--count", optarg, 1, COUNT_LIMIT, &number))
+      {
+        usage(argv[0]);
+        return 1;
+      }
+      g_test.count = number;
+      break;
+    case 'f':
+      if (!parse_number("--rate", optarg, 1, RATE_LIMIT, &number))
+      {
+        usage(argv[0]);
+        return 1;
+      }
+      g_test.rate = number;
+      break;
+    case 'b':
+      if (!parse_number("--buffer-size", optarg, 1, BUFFER_SIZE_LIMIT, &number))
+      {
+        usage(argv[0]);
+        return 1;
+      }
+      buffer_size = number;
+      break;
+    case 'j':
+      server_name = optarg;
+      break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  g_test.results = calloc(g_test.count, sizeof(int64_t));
+  if (g_test.results == NULL)
+  {
+    fprintf(stderr, "Out of memory.\n");
+    return 1;
+  }
+
+  if (snd_seq_open(&g_test.seq, "hw", SND_SEQ_OPEN_DUPLEX, 0) < 0)
+  {
+    fprintf(stderr, "Error opening ALSA sequencer.\n");
+    goto free_results;
+  }
+
+  snd_seq_set_client_name(g_test.seq, CLIENT_NAME);
+  g_test.seq_port = snd_seq_create_simple_port(
+    g_test.seq,
+    "loop",
+    SND_SEQ_PORT_CAP_READ | SND_SEQ_PORT_CAP_SUBS_READ | SND_SEQ_PORT_CAP_WRITE | SND_SEQ_PORT_CAP_SUBS_WRITE,
+    SND_SEQ_PORT_TYPE_MIDI_GENERIC | SND_SEQ_PORT_TYPE_APPLICATION);
+  if (g_test.seq_port < 0)
+  {
+    fprintf(stderr, "Error creating sequencer port.\n");
+    goto close_seq;
+  }
+
+  /* a probe measures the server that is running, it never starts one */
+  g_test.jack_client = jack_client_open(CLIENT_NAME, server_name != NULL ? JackServerName | JackNoStartServer : JackNoStartServer, &status, server_name);
+  if (g_test.jack_client == NULL)
+  {
+    fprintf(stderr, "Failed to connect to JACK server!\n");
+    goto close_seq;
+  }
+
+  /* the buffer size is server wide, it is put back when the test is done */
+  old_buffer_size = jack_get_buffer_size(g_test.jack_client);
+  if (buffer_size != 0 && buffer_size != old_buffer_size && jack_set_buffer_size(g_test.jack_client, buffer_size) != 0)
+  {
+    fprintf(stderr, "Failed to set JACK buffer size to %u.\n", (unsigned int)buffer_size);
+  }
+
+  g_test.interval = jack_get_sample_rate(g_test.jack_client) / g_test.rate;
+  if (g_test.interval == 0)
+  {
+    g_test.interval = 1;
+  }
+
+  g_test.jack_out = jack_port_register(g_test.jack_client, "probe_out", JACK_DEFAULT_MIDI_TYPE, JackPortIsOutput, 0);
+  g_test.jack_in = jack_port_register(g_test.jack_client, "probe_in", JACK_DEFAULT_MIDI_TYPE, JackPortIsInput, 0);
+  if (g_test.jack_out == NULL || g_test.jack_in == NULL)
+  {
+    fprintf(stderr, "Failed to create JACK MIDI ports!\n");
+    goto close_jack;
+  }
+
+  signal(SIGINT, &sigint_handler);
+  signal(SIGTERM, &sigint_handler);
+
+  jack_on_shutdown(g_test.jack_client, jack_shutdown, NULL);
+
+  /* jack process does nothing until probes are enabled below */
+  g_test.sent = g_test.count;
+  jack_set_process_callback(g_test.jack_client, jack_process, NULL);
+
+  if (jack_activate(g_test.jack_client))
+  {
+    fprintf(stderr, "Failed to activate JACK client!\n");
+    goto close_jack;
+  }
+
+  if (!connect_bridge())
+  {
+    goto close_jack;
+  }
+
+  /* let the port connections settle before probing */
+  usleep(200000);
+  __atomic_store_n(&g_test.sent, 0, __ATOMIC_RELEASE);
+
+  run();
+  report();
+  ret = 0;
+
+close_jack:
+  if (jack_get_buffer_size(g_test.jack_client) != old_buffer_size &&
+      jack_set_buffer_size(g_test.jack_client, old_buffer_size) != 0)
+  {
+    fprintf(stderr, "Failed to restore JACK buffer size to %u.\n", (unsigned int)old_buffer_size);
+  }
+
+  jack_client_close(g_test.jack_client);
+close_seq:
+  snd_seq_close(g_test.seq);
+free_results:
+  free(g_test.results);
+
+  return ret;
+}
@@ -0,0 +1,1077 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * ALSA SEQ < - > JACK MIDI bridge
+ *
+ * Copyright (c) 2026 The a2jmidid authors
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ */
+
+/* Reads traces recorded with a2jmidid --trace. Reports timing of the
+ * recorded events or replays them through the bridge code, running in
+ * this process on the mock JACK server and sequencer of the benchmarks:
+ * the ALSA input events go to the input thread, the JACK output events
+ * into the playback port buffers of the cycles that queued them. */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sched.h>
+#include <stdarg.h>
+#include <pthread.h>
+#include <alsa/asoundlib.h>
+#include <jack/jack.h>
+#include <jack/midiport.h>
+#include <jack/ringbuffer.h>
+
+#include "list.h"
+#include "structs.h"
+#include "conf.h"
+#include "log.h"
+#include "memlock.h"
+#include "trace.h"
+#include "bench/mock.h"
+
+#define NSEC_PER_SEC ((int64_t)1000*1000*1000)
+
+struct trace_event
+{
+  struct a2j_trace_record record;
+  size_t data_offset;
+  size_t index;                 /* file order, keeps sorting stable */
+};
+
+struct trace
+{
+  struct a2j_trace_header header;
+  struct trace_event * events;
+  size_t count;
+  unsigned char * data;
+  size_t data_size;
+  uint32_t max_event_size;
+};
+
+struct stat_values
+{
+  uint64_t count;
+  int64_t sum;
+  int64_t min;
+  int64_t max;
+};
+
+struct trace_port
+{
+  uint8_t client;
+  uint8_t port;
+  uint64_t events[2];           /* input, output */
+  uint64_t bytes[2];
+
+  /* replay */
+  struct a2j_port * bridge[2];  /* capture, playback */
+  size_t pending_head;          /* inputs not delivered yet, oldest first */
+  size_t pending_tail;
+};
+
+#define MAX_TRACE_PORTS 256
+
+static
+void
+stat_add(
+  struct stat_values * stat_ptr,
+  int64_t value)
+{
+  if (stat_ptr->count == 0 || value < stat_ptr->min)
+  {
+    stat_ptr->min = value;
+  }
+
+  if (stat_ptr->count == 0 || value > stat_ptr->max)
+  {
+    stat_ptr->max = value;
+  }
+
+  stat_ptr->count++;
+  stat_ptr->sum += value;
+}
+
+static
+void
+stat_print(
+  const struct stat_values * stat_ptr,
+  const char * name,
+  const char * unit)
+{
+  if (stat_ptr->count == 0)
+  {
+    printf("%s: no samples\n", name);
+    return;
+  }
+
+  printf(
+    "%s: %llu samples, min %lld %s, avg %lld %s, max %lld %s\n",
+    name,
+    (unsigned long long)stat_ptr->count,
+    (long long)stat_ptr->min, unit,
+    (long long)(stat_ptr->sum / (int64_t)stat_ptr->count), unit,
+    (long long)stat_ptr->max, unit);
+}
+
+static
+int
+trace_event_compare(
+  const void * a,
+  const void * b)
+{
+  const struct trace_event * event_a = a;
+  const struct trace_event * event_b = b;
+
+  if (event_a->record.usecs != event_b->record.usecs)
+  {
+    return event_a->record.usecs < event_b->record.usecs ? -1 : 1;
+  }
+
+  return event_a->index < event_b->index ? -1 : 1;
+}
+
+static
+bool
+trace_load(
+  const char * path,
+  struct trace * trace_ptr)
+{
+  FILE * file;
+  struct trace_event * events;
+  unsigned char * data;
+  size_t events_size;
+  size_t data_size;
+  struct a2j_trace_record record;
+  size_t size;
+
+  memset(trace_ptr, 0, sizeof(struct trace));
+
+  file = fopen(path, "rb");
+  if (file == NULL)
+  {
+    fprintf(stderr, "Cannot open \"%s\": %s\n", path, strerror(errno));
+    return false;
+  }
+
+  if (fread(&trace_ptr->header, sizeof(trace_ptr->header), 1, file) != 1 ||
+      memcmp(trace_ptr->header.magic, A2J_TRACE_MAGIC, sizeof(trace_ptr->header.magic)) != 0 ||
+      trace_ptr->header.version < 1 ||
+      trace_ptr->header.version > A2J_TRACE_VERSION)
+  {
+    fprintf(stderr, "\"%s\" is not an a2jmidid trace\n", path);
+    goto fail;
+  }
+
+  events_size = 0;
+  data_size = 0;
+
+  while (fread(&record, sizeof(record), 1, file) == 1)
+  {
+    size = record.type == A2J_TRACE_INPUT || record.type == A2J_TRACE_OUTPUT ? record.size : 0;
+
+    /* version 1 recorders always delivered inputs one period after arrival */
+    if (trace_ptr->header.version == 1 && record.type == A2J_TRACE_CYCLE)
+    {
+      record.input_delay = record.size;
+    }
+
+    if (trace_ptr->count == events_size)
+    {
+      events_size = events_size ? events_size * 2 : 4096;
+      events = realloc(trace_ptr->events, events_size * sizeof(struct trace_event));
+      if (events == NULL)
+      {
+        goto fail_oom;
+      }
+      trace_ptr->events = events;
+    }
+
+    if (trace_ptr->data_size + size > data_size)
+    {
+      data_size = data_size ? data_size * 2 : 65536;
+      if (data_size < trace_ptr->data_size + size)
+      {
+        data_size = trace_ptr->data_size + size;
+      }
+      data = realloc(trace_ptr->data, data_size);
+      if (data == NULL)
+      {
+        goto fail_oom;
+      }
+      trace_ptr->data = data;
+    }
+
+    if (size > 0 && fread(trace_ptr->data + trace_ptr->data_size, size, 1, file) != 1)
+    {
+      fprintf(stderr, "\"%s\" is truncated\n", path);
+      break;
+    }
+
+    if (size > trace_ptr->max_event_size)
+    {
+      trace_ptr->max_event_size = size;
+    }
+
+    trace_ptr->events[trace_ptr->count].record = record;
+    trace_ptr->events[trace_ptr->count].data_offset = trace_ptr->data_size;
+    trace_ptr->events[trace_ptr->count].index = trace_ptr->count;
+    trace_ptr->count++;
+    trace_ptr->data_size += size;
+  }
+
+  fclose(file);
+
+  /* the input thread and jack process records are stored in separate batches */
+  qsort(trace_ptr->events, trace_ptr->count, sizeof(struct trace_event), trace_event_compare);
+
+  return true;
+
+fail_oom:
+  fprintf(stderr, "Out of memory loading \"%s\"\n", path);
+
+fail:
+  free(trace_ptr->events);
+  free(trace_ptr->data);
+  fclose(file);
+  return false;
+}
+
+static
+struct trace_port *
+trace_port_get(
+  struct trace_port * ports,
+  unsigned int * count_ptr,
+  const struct a2j_trace_record * record_ptr)
+{
+  unsigned int i;
+
+  for (i = 0; i < *count_ptr; i++)
+  {
+    if (ports[i].client == record_ptr->client && ports[i].port == record_ptr->port)
+    {
+      return ports + i;
+    }
+  }
+
+  if (*count_ptr == MAX_TRACE_PORTS)
+  {
+    return NULL;
+  }
+
+  memset(ports + i, 0, sizeof(struct trace_port));
+  ports[i].client = record_ptr->client;
+  ports[i].port = record_ptr->port;
+  ports[i].pending_head = SIZE_MAX;
+  ports[i].pending_tail = SIZE_MAX;
+  (*count_ptr)++;
+
+  return ports + i;
+}
+
+static
+int64_t
+frames_to_usecs(
+  const struct trace * trace_ptr,
+  int64_t frames)
+{
+  return frames * 1000000 / trace_ptr->header.sample_rate;
+}
+
+/* the first cycle after the arrival whose period covers the event frame
+   plus the input delay of that cycle delivers input i to JACK, at position
+   frames into the period, or at its start when position is negative */
+static
+bool
+trace_input_delivery(
+  const struct trace * trace_ptr,
+  size_t i,
+  size_t * cycle_ptr,
+  int32_t * position_ptr)
+{
+  const struct a2j_trace_record * record_ptr;
+  const struct a2j_trace_record * next_ptr;
+  size_t next_cycle;
+
+  record_ptr = &trace_ptr->events[i].record;
+
+  for (next_cycle = i + 1; next_cycle < trace_ptr->count; next_cycle++)
+  {
+    next_ptr = &trace_ptr->events[next_cycle].record;
+    if (next_ptr->type != A2J_TRACE_CYCLE)
+    {
+      continue;
+    }
+
+    *position_ptr = (int32_t)(record_ptr->frame + next_ptr->input_delay - next_ptr->frame);
+    if (*position_ptr < (int32_t)next_ptr->size)
+    {
+      *cycle_ptr = next_cycle;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static
+int
+trace_report(
+  const struct trace * trace_ptr)
+{
+  struct trace_port ports[MAX_TRACE_PORTS];
+  unsigned int ports_count;
+  struct trace_port * port_ptr;
+  const struct a2j_trace_record * record_ptr;
+  const struct a2j_trace_record * cycle_ptr;
+  struct stat_values cycle_jitter;
+  struct stat_values input_wait;
+  struct stat_values output_lead;
+  uint64_t cycles;
+  uint64_t xruns;
+  uint64_t late_inputs;
+  uint64_t lost;
+  size_t i;
+  size_t next_cycle;
+  int32_t position;
+  unsigned int dir;
+
+  memset(&cycle_jitter, 0, sizeof(cycle_jitter));
+  memset(&input_wait, 0, sizeof(input_wait));
+  memset(&output_lead, 0, sizeof(output_lead));
+  ports_count = 0;
+  cycles = 0;
+  xruns = 0;
+  late_inputs = 0;
+  lost = 0;
+  cycle_ptr = NULL;
+
+  printf("sample rate %u, buffer size %u, %zu records\n", trace_ptr->header.sample_rate, trace_ptr->header.buffer_size, trace_ptr->count);
+
+  switch (trace_ptr->header.input_delay)
+  {
+  case A2J_TRACE_INPUT_DELAY_PERIOD:
+    printf("input delay: one period\n");
+    break;
+  case A2J_TRACE_INPUT_DELAY_ADAPTIVE:
+    printf("input delay: adaptive\n");
+    break;
+  default:
+    printf("input delay: %u frames\n", trace_ptr->header.input_delay);
+  }
+
+  for (i = 0; i < trace_ptr->count; i++)
+  {
+    record_ptr = &trace_ptr->events[i].record;
+
+    switch (record_ptr->type)
+    {
+    case A2J_TRACE_CYCLE:
+      if (cycle_ptr != NULL)
+      {
+        /* wakeup jitter against the nominal period, and cycles that did not follow each other */
+        stat_add(&cycle_jitter, (int64_t)(record_ptr->usecs - cycle_ptr->usecs) - frames_to_usecs(trace_ptr, cycle_ptr->size));
+        if (record_ptr->frame - cycle_ptr->frame != cycle_ptr->size)
+        {
+          xruns++;
+        }
+      }
+      cycle_ptr = record_ptr;
+      cycles++;
+      break;
+
+    case A2J_TRACE_INPUT:
+    case A2J_TRACE_OUTPUT:
+      dir = record_ptr->type == A2J_TRACE_INPUT ? 0 : 1;
+      port_ptr = trace_port_get(ports, &ports_count, record_ptr);
+      if (port_ptr != NULL)
+      {
+        port_ptr->events[dir]++;
+        port_ptr->bytes[dir] += record_ptr->size;
+      }
+
+      if (record_ptr->type == A2J_TRACE_OUTPUT)
+      {
+        if (cycle_ptr != NULL)
+        {
+          stat_add(&output_lead, frames_to_usecs(trace_ptr, (int32_t)(record_ptr->frame - cycle_ptr->frame)));
+        }
+        break;
+      }
+
+      if (trace_input_delivery(trace_ptr, i, &next_cycle, &position))
+      {
+        stat_add(&input_wait, (int64_t)(trace_ptr->events[next_cycle].record.usecs - record_ptr->usecs));
+        if (position < 0)
+        {
+          /* past its delivery frame, a2j_process_incoming() puts it at the start of the buffer */
+          late_inputs++;
+        }
+      }
+      break;
+
+    case A2J_TRACE_LOST:
+      lost += record_ptr->size;
+      break;
+    }
+  }
+
+  printf("%llu cycles, %llu discontinuities, %llu records lost while recording\n", (unsigned long long)cycles, (unsigned long long)xruns, (unsigned long long)lost);
+  stat_print(&cycle_jitter, "cycle start jitter", "us");
+  stat_print(&input_wait, "input arrival to pickup", "us");
+  printf("inputs picked up after their delivery frame: %llu\n", (unsigned long long)late_inputs);
+  stat_print(&output_lead, "output due after cycle start", "us");
+
+  for (i = 0; i < ports_count; i++)
+  {
+    printf(
+      "port %u:%u: %llu events (%llu bytes) in, %llu events (%llu bytes) out\n",
+      (unsigned int)ports[i].client,
+      (unsigned int)ports[i].port,
+      (unsigned long long)ports[i].events[0],
+      (unsigned long long)ports[i].bytes[0],
+      (unsigned long long)ports[i].events[1],
+      (unsigned long long)ports[i].bytes[1]);
+  }
+
+  return 0;
+}
+
+static
+int64_t
+monotonic_nsec(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+/* the log of the bridge code */
+void
+a2j_log(
+  unsigned int level,
+  const char * format,
+  ...)
+{
+  va_list ap;
+
+  va_start(ap, format);
+  vfprintf(stderr, format, ap);
+  va_end(ap);
+}
+
+/* an input in flight through the bridge */
+struct replay_input
+{
+  int64_t arrival;              /* usecs, when it was injected */
+  int64_t recorded;             /* usecs from arrival to the JACK frame it was delivered at, when recorded */
+  bool recorded_valid;          /* the trace has the cycle that delivered it */
+  size_t next;                  /* of the same port */
+};
+
+struct replay
+{
+  const struct trace * trace_ptr;
+  bool realtime;
+  struct a2j * bridge;
+  snd_midi_event_t * codec;
+  struct trace_port ports[MAX_TRACE_PORTS];
+  unsigned int ports_count;
+  struct replay_input * inputs;
+  size_t inputs_count;
+  uint64_t cycles;
+  uint64_t outputs;             /* JACK events queued in playback port buffers */
+  uint64_t delivered;           /* inputs delivered to capture port buffers */
+  uint64_t skipped;             /* events of ports beyond MAX_TRACE_PORTS, or not in the period of their cycle */
+  uint64_t errors;              /* inputs the codec or the sequencer did not take */
+  struct stat_values cycle_cost;
+  struct stat_values cycle_deviation;
+  struct stat_values recorded_latency;
+  struct stat_values replayed_latency;
+  struct stat_values latency_deviation;
+};
+
+static
+void
+replay_sleep(
+  int64_t deadline)
+{
+  struct timespec ts;
+
+  ts.tv_sec = deadline / NSEC_PER_SEC;
+  ts.tv_nsec = deadline % NSEC_PER_SEC;
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+  {
+  }
+}
+
+/* send input i from its port, like a sequencer client would */
+static
+void
+replay_input(
+  struct replay * replay_ptr,
+  size_t i)
+{
+  const struct trace * trace_ptr = replay_ptr->trace_ptr;
+  const struct a2j_trace_record * record_ptr;
+  struct trace_port * port_ptr;
+  struct replay_input * input_ptr;
+  snd_seq_event_t alsa_event;
+  const unsigned char * data;
+  size_t cycle;
+  int32_t position;
+  long consumed;
+
+  record_ptr = &trace_ptr->events[i].record;
+  port_ptr = trace_port_get(replay_ptr->ports, &replay_ptr->ports_count, record_ptr);
+  if (port_ptr == NULL || port_ptr->bridge[A2J_PORT_CAPTURE] == NULL)
+  {
+    replay_ptr->skipped++;
+    return;
+  }
+
+  /* each record is one JACK event, a complete message */
+  data = trace_ptr->data + trace_ptr->events[i].data_offset;
+  snd_midi_event_reset_encode(replay_ptr->codec);
+  snd_seq_ev_clear(&alsa_event);
+  consumed = snd_midi_event_encode(replay_ptr->codec, data, record_ptr->size, &alsa_event);
+  if (consumed != (long)record_ptr->size || alsa_event.type == SND_SEQ_EVENT_NONE)
+  {
+    replay_ptr->errors++;
+    return;
+  }
+
+  /* the encoder buffer is reused by the next input, the trace data stays */
+  if (snd_seq_ev_is_variable(&alsa_event))
+  {
+    alsa_event.data.ext.ptr = (void *)data;
+  }
+
+  alsa_event.source = a2j_mock_bridge_addr(port_ptr - replay_ptr->ports);
+  alsa_event.dest.client = A2J_MOCK_CLIENT_ID;
+  alsa_event.dest.port = 0;
+  snd_seq_ev_set_direct(&alsa_event);
+
+  input_ptr = replay_ptr->inputs + replay_ptr->inputs_count;
+  input_ptr->arrival = monotonic_nsec() / 1000;
+  if (a2j_mock_seq_inject(replay_ptr->bridge->seq, &alsa_event, 1) != 1)
+  {
+    replay_ptr->errors++;
+    return;
+  }
+
+  input_ptr->recorded_valid = trace_input_delivery(trace_ptr, i, &cycle, &position);
+  if (input_ptr->recorded_valid)
+  {
+    input_ptr->recorded =
+      (int64_t)(trace_ptr->events[cycle].record.usecs - record_ptr->usecs) +
+      frames_to_usecs(trace_ptr, position > 0 ? position : 0);
+  }
+
+  input_ptr->next = SIZE_MAX;
+  if (port_ptr->pending_tail == SIZE_MAX)
+  {
+    port_ptr->pending_head = replay_ptr->inputs_count;
+  }
+  else
+  {
+    replay_ptr->inputs[port_ptr->pending_tail].next = replay_ptr->inputs_count;
+  }
+  port_ptr->pending_tail = replay_ptr->inputs_count;
+  replay_ptr->inputs_count++;
+}
+
+/* match what the cycle delivered to the capture ports with the inputs, oldest first */
+static
+void
+replay_collect(
+  struct replay * replay_ptr)
+{
+  struct a2j * self = replay_ptr->bridge;
+  struct trace_port * port_ptr;
+  struct replay_input * input_ptr;
+  jack_midi_event_t event;
+  jack_nframes_t frames;
+  jack_time_t usecs;
+  jack_time_t next_usecs;
+  float period_usecs;
+  void * buffer;
+  uint32_t count;
+  uint32_t j;
+  int64_t latency;
+  unsigned int i;
+
+  self->backend.jack->get_cycle_times(self->jack_client, &frames, &usecs, &next_usecs, &period_usecs);
+
+  for (i = 0; i < replay_ptr->ports_count; i++)
+  {
+    port_ptr = replay_ptr->ports + i;
+    if (port_ptr->pending_head == SIZE_MAX)
+    {
+      continue;
+    }
+
+    buffer = self->backend.jack->port_get_buffer(port_ptr->bridge[A2J_PORT_CAPTURE]->jack_port, replay_ptr->trace_ptr->header.buffer_size);
+    count = self->backend.jack->midi_get_event_count(buffer);
+
+    for (j = 0; j < count && port_ptr->pending_head != SIZE_MAX; j++)
+    {
+      self->backend.jack->midi_event_get(&event, buffer, j);
+
+      input_ptr = replay_ptr->inputs + port_ptr->pending_head;
+      port_ptr->pending_head = input_ptr->next;
+
+      latency = (int64_t)usecs + frames_to_usecs(replay_ptr->trace_ptr, event.time) - input_ptr->arrival;
+      stat_add(&replay_ptr->replayed_latency, latency);
+      if (input_ptr->recorded_valid)
+      {
+        stat_add(&replay_ptr->recorded_latency, input_ptr->recorded);
+        stat_add(&replay_ptr->latency_deviation, latency - input_ptr->recorded);
+      }
+
+      replay_ptr->delivered++;
+    }
+
+    if (port_ptr->pending_head == SIZE_MAX)
+    {
+      port_ptr->pending_tail = SIZE_MAX;
+    }
+  }
+}
+
+static
+bool
+replay_pending(
+  const struct replay * replay_ptr)
+{
+  unsigned int i;
+
+  for (i = 0; i < replay_ptr->ports_count; i++)
+  {
+    if (replay_ptr->ports[i].pending_head != SIZE_MAX)
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/* run the cycle recorded at cycle, with the outputs jack process queued in
+   it, or an extra one to flush the bridge when cycle is past the trace */
+static
+void
+replay_cycle(
+  struct replay * replay_ptr,
+  size_t cycle)
+{
+  const struct trace * trace_ptr = replay_ptr->trace_ptr;
+  const struct a2j_trace_record * record_ptr;
+  struct trace_port * port_ptr;
+  jack_nframes_t offset;
+  int64_t before;
+  size_t i;
+
+  /* process records of a cycle come before the next one */
+  for (i = cycle + 1; cycle < trace_ptr->count && i < trace_ptr->count && trace_ptr->events[i].record.type != A2J_TRACE_CYCLE; i++)
+  {
+    record_ptr = &trace_ptr->events[i].record;
+    if (record_ptr->type != A2J_TRACE_OUTPUT)
+    {
+      continue;
+    }
+
+    port_ptr = trace_port_get(replay_ptr->ports, &replay_ptr->ports_count, record_ptr);
+    offset = record_ptr->frame - trace_ptr->events[cycle].record.frame;
+    if (port_ptr == NULL ||
+        port_ptr->bridge[A2J_PORT_PLAYBACK] == NULL ||
+        offset >= trace_ptr->header.buffer_size ||
+        !a2j_mock_jack_midi_add(
+          port_ptr->bridge[A2J_PORT_PLAYBACK]->jack_port,
+          offset,
+          trace_ptr->data + trace_ptr->events[i].data_offset,
+          record_ptr->size))
+    {
+      replay_ptr->skipped++;
+      continue;
+    }
+
+    replay_ptr->outputs++;
+  }
+
+  before = monotonic_nsec();
+  a2j_mock_jack_cycle();
+  stat_add(&replay_ptr->cycle_cost, monotonic_nsec() - before);
+  replay_ptr->cycles++;
+
+  replay_collect(replay_ptr);
+}
+
+/* outputs the output thread sent or jack process dropped */
+static
+uint64_t
+replay_outputs_done(
+  const struct replay * replay_ptr)
+{
+  struct a2j_port_stats stats;
+  uint64_t done;
+  unsigned int i;
+
+  done = 0;
+  for (i = 0; i < replay_ptr->ports_count; i++)
+  {
+    if (replay_ptr->ports[i].bridge[A2J_PORT_PLAYBACK] != NULL)
+    {
+      a2j_port_stats_read(&replay_ptr->ports[i].bridge[A2J_PORT_PLAYBACK]->stats, &stats);
+      done += stats.events + stats.dropped_ring_full + stats.dropped_sysex + stats.dropped_too_large;
+    }
+  }
+
+  return done;
+}
+
+static
+void
+replay_report(
+  const struct replay * replay_ptr,
+  uint64_t input_nsecs,
+  uint64_t output_nsecs)
+{
+  struct a2j_port_stats totals[2];
+  struct a2j_port_stats stats;
+  struct a2j_histogram lateness;
+  unsigned int dir;
+  unsigned int i;
+
+  memset(totals, 0, sizeof(totals));
+  for (i = 0; i < replay_ptr->ports_count; i++)
+  {
+    for (dir = 0; dir < 2; dir++)
+    {
+      if (replay_ptr->ports[i].bridge[dir] != NULL)
+      {
+        a2j_port_stats_read(&replay_ptr->ports[i].bridge[dir]->stats, &stats);
+        a2j_port_stats_accumulate(totals + dir, &stats);
+      }
+    }
+  }
+
+  printf(
+    "replayed %s: %llu cycles, %zu inputs and %llu outputs through %u ports, %llu records skipped, %llu inputs failed\n",
+    replay_ptr->realtime ? "with the recorded timing" : "as fast as possible",
+    (unsigned long long)replay_ptr->cycles,
+    replay_ptr->inputs_count,
+    (unsigned long long)replay_ptr->outputs,
+    replay_ptr->ports_count,
+    (unsigned long long)replay_ptr->skipped,
+    (unsigned long long)replay_ptr->errors);
+
+  printf(
+    "input: %llu delivered to JACK, %llu not delivered, dropped %llu ring full, %llu JACK buffer full, %llu SysEx, %llu codec errors, %llu late\n",
+    (unsigned long long)replay_ptr->delivered,
+    (unsigned long long)(replay_ptr->inputs_count - replay_ptr->delivered),
+    (unsigned long long)totals[A2J_PORT_CAPTURE].dropped_ring_full,
+    (unsigned long long)totals[A2J_PORT_CAPTURE].dropped_jack_buffer,
+    (unsigned long long)totals[A2J_PORT_CAPTURE].dropped_sysex,
+    (unsigned long long)totals[A2J_PORT_CAPTURE].codec_errors,
+    (unsigned long long)totals[A2J_PORT_CAPTURE].late);
+
+  printf(
+    "output: %llu sent to the sequencer, dropped %llu ring full, %llu SysEx, %llu too large, %llu codec errors, %llu sequencer errors\n",
+    (unsigned long long)totals[A2J_PORT_PLAYBACK].events,
+    (unsigned long long)totals[A2J_PORT_PLAYBACK].dropped_ring_full,
+    (unsigned long long)totals[A2J_PORT_PLAYBACK].dropped_sysex,
+    (unsigned long long)totals[A2J_PORT_PLAYBACK].dropped_too_large,
+    (unsigned long long)totals[A2J_PORT_PLAYBACK].codec_errors,
+    (unsigned long long)totals[A2J_PORT_PLAYBACK].output_errors);
+
+  stat_print(&replay_ptr->cycle_cost, "process cycle cost", "ns");
+  printf(
+    "cost per event: process %.0f ns, input thread %.0f ns, output thread %.0f ns\n",
+    replay_ptr->delivered + replay_ptr->outputs ? (double)replay_ptr->cycle_cost.sum / (replay_ptr->delivered + replay_ptr->outputs) : 0,
+    replay_ptr->inputs_count ? (double)input_nsecs / replay_ptr->inputs_count : 0,
+    totals[A2J_PORT_PLAYBACK].events ? (double)output_nsecs / totals[A2J_PORT_PLAYBACK].events : 0);
+
+  if (!replay_ptr->realtime)
+  {
+    return;
+  }
+
+  stat_print(&replay_ptr->cycle_deviation, "cycle start deviation", "us");
+  stat_print(&replay_ptr->recorded_latency, "input arrival to delivery, recorded", "us");
+  stat_print(&replay_ptr->replayed_latency, "input arrival to delivery, replayed", "us");
+  stat_print(&replay_ptr->latency_deviation, "input delivery deviation, replayed less recorded", "us");
+
+  /* the output thread measures each event against its recorded JACK time */
+  a2j_histogram_read(&replay_ptr->bridge->output_lateness, &lateness);
+  if (lateness.count == 0)
+  {
+    printf("output sent after due time: no samples\n");
+    return;
+  }
+
+  printf(
+    "output sent after due time: %llu samples, min %lld us, avg %lld us, 99%% %lld us, max %lld us\n",
+    (unsigned long long)lateness.count,
+    (long long)lateness.min,
+    (long long)(lateness.sum / (int64_t)lateness.count),
+    (long long)a2j_histogram_percentile(&lateness, 99),
+    (long long)lateness.max);
+}
+
+static
+int
+trace_replay(
+  const struct trace * trace_ptr,
+  bool realtime)
+{
+  struct replay * replay_ptr;
+  const struct a2j_trace_record * record_ptr;
+  uint64_t thread_nsecs[2][2];  /* input, output thread before and after */
+  int64_t period;
+  int64_t start;
+  int64_t deadline;
+  size_t inputs;
+  size_t i;
+  unsigned int dir;
+  int ret;
+
+  ret = 1;
+  memset(thread_nsecs, 0, sizeof(thread_nsecs));
+
+  if (trace_ptr->header.sample_rate == 0 || trace_ptr->header.buffer_size == 0)
+  {
+    fprintf(stderr, "The trace has no sample rate or buffer size\n");
+    goto exit;
+  }
+
+  replay_ptr = calloc(1, sizeof(struct replay));
+  if (replay_ptr == NULL)
+  {
+    fprintf(stderr, "Out of memory\n");
+    goto exit;
+  }
+
+  replay_ptr->trace_ptr = trace_ptr;
+  replay_ptr->realtime = realtime;
+
+  /* one bridged client port per recorded port */
+  inputs = 0;
+  for (i = 0; i < trace_ptr->count; i++)
+  {
+    record_ptr = &trace_ptr->events[i].record;
+    if (record_ptr->type == A2J_TRACE_INPUT || record_ptr->type == A2J_TRACE_OUTPUT)
+    {
+      trace_port_get(replay_ptr->ports, &replay_ptr->ports_count, record_ptr);
+    }
+
+    if (record_ptr->type == A2J_TRACE_INPUT)
+    {
+      inputs++;
+    }
+  }
+
+  replay_ptr->inputs = malloc((inputs > 0 ? inputs : 1) * sizeof(struct replay_input));
+  if (replay_ptr->inputs == NULL)
+  {
+    fprintf(stderr, "Out of memory\n");
+    goto free_replay;
+  }
+
+  if (snd_midi_event_new(trace_ptr->max_event_size > 0 ? trace_ptr->max_event_size : 16, &replay_ptr->codec) < 0)
+  {
+    fprintf(stderr, "Error initializing ALSA MIDI encoder!\n");
+    goto free_inputs;
+  }
+
+  /* the settings the trace was recorded with, as far as it tells */
+  switch (trace_ptr->header.input_delay)
+  {
+  case A2J_TRACE_INPUT_DELAY_PERIOD:
+    break;
+  case A2J_TRACE_INPUT_DELAY_ADAPTIVE:
+    g_a2j_input_delay_adaptive = true;
+    break;
+  default:
+    g_a2j_input_delay = trace_ptr->header.input_delay;
+  }
+
+  if (trace_ptr->max_event_size > g_a2j_max_event_size)
+  {
+    g_a2j_max_event_size = trace_ptr->max_event_size;
+  }
+
+  replay_ptr->bridge = a2j_mock_bridge_new(trace_ptr->header.buffer_size, trace_ptr->header.sample_rate, replay_ptr->ports_count, true);
+  if (replay_ptr->bridge == NULL)
+  {
+    fprintf(stderr, "Cannot set up the bridge\n");
+    goto free_codec;
+  }
+
+  for (i = 0; i < replay_ptr->ports_count; i++)
+  {
+    for (dir = 0; dir < 2; dir++)
+    {
+      replay_ptr->ports[i].bridge[dir] = a2j_mock_bridge_port(replay_ptr->bridge, dir, i);
+    }
+  }
+
+  a2j_thread_cpu_nsecs(replay_ptr->bridge->alsa_input_thread, &thread_nsecs[0][0]);
+  a2j_thread_cpu_nsecs(replay_ptr->bridge->alsa_output_thread, &thread_nsecs[1][0]);
+
+  period = (int64_t)trace_ptr->header.buffer_size * NSEC_PER_SEC / trace_ptr->header.sample_rate;
+  start = monotonic_nsec();
+  deadline = start;
+
+  for (i = 0; i < trace_ptr->count; i++)
+  {
+    record_ptr = &trace_ptr->events[i].record;
+    if (record_ptr->type != A2J_TRACE_INPUT && record_ptr->type != A2J_TRACE_CYCLE)
+    {
+      continue;
+    }
+
+    if (realtime)
+    {
+      deadline = start + (int64_t)(record_ptr->usecs - trace_ptr->events[0].record.usecs) * 1000;
+      replay_sleep(deadline);
+    }
+
+    if (record_ptr->type == A2J_TRACE_INPUT)
+    {
+      replay_input(replay_ptr, i);
+      continue;
+    }
+
+    if (realtime)
+    {
+      stat_add(&replay_ptr->cycle_deviation, (monotonic_nsec() - deadline) / 1000);
+    }
+    else
+    {
+      /* everything sent before the cycle arrives in the period before it */
+      while (a2j_mock_seq_pending(replay_ptr->bridge->seq) != 0)
+      {
+        sched_yield();
+      }
+    }
+
+    replay_cycle(replay_ptr, i);
+  }
+
+  /* inputs still waiting for their delivery frame, give them a second */
+  for (i = 0; i < trace_ptr->header.sample_rate / trace_ptr->header.buffer_size + 1 && replay_pending(replay_ptr); i++)
+  {
+    if (realtime)
+    {
+      deadline += period;
+      replay_sleep(deadline);
+    }
+    else
+    {
+      while (a2j_mock_seq_pending(replay_ptr->bridge->seq) != 0)
+      {
+        sched_yield();
+      }
+    }
+
+    replay_cycle(replay_ptr, SIZE_MAX);
+  }
+
+  /* the output thread sends the last outputs when they are due */
+  for (i = 0; i < 100 && replay_outputs_done(replay_ptr) < replay_ptr->outputs; i++)
+  {
+    usleep(10000);
+  }
+
+  a2j_thread_cpu_nsecs(replay_ptr->bridge->alsa_input_thread, &thread_nsecs[0][1]);
+  a2j_thread_cpu_nsecs(replay_ptr->bridge->alsa_output_thread, &thread_nsecs[1][1]);
+
+  replay_report(replay_ptr, thread_nsecs[0][1] - thread_nsecs[0][0], thread_nsecs[1][1] - thread_nsecs[1][0]);
+
+  ret = replay_ptr->errors > 0 ? 1 : 0;
+
+  a2j_mock_bridge_free(replay_ptr->bridge);
+free_codec:
+  snd_midi_event_free(replay_ptr->codec);
+free_inputs:
+  free(replay_ptr->inputs);
+free_replay:
+  free(replay_ptr);
+exit:
+  return ret;
+}
+
+static
+void
+usage(
+  const char * self)
+{
+  fprintf(stderr, "Usage: %s report file\n", self);
+  fprintf(stderr, "       %s replay [-r] file\n", self);
+  fprintf(stderr, "  -r  keep the recorded timing instead of running the cycles as fast as possible\n");
+}
+int
+main(
+  int argc,
+  char *argv[])
+{
+  struct trace trace;
+  bool realtime;
+  const char * path;
+  int ret;
+
+  if (argc == 3 && (strcmp(argv[1], "report") == 0 || strcmp(argv[1], "replay") == 0) && argv[2][0] != '-')
+  {
+    realtime = false;
+  }
+  else if (argc == 4 && strcmp(argv[1], "replay") == 0 && strcmp(argv[2], "-r") == 0)
+  {
+    realtime = true;
+  }
+  else
+  {
+    usage(argv[0]);
+    return 1;
+  }
+
+  path = argv[argc - 1];
+
+  if (!trace_load(path, &trace))
+  {
+    return 1;
+  }
+
+  if (strcmp(argv[1], "report") == 0)
+  {
+    ret = trace_report(&trace);
+  }
+  else
+  {
+    ret = trace_replay(&trace, realtime);
+  }
+
+  free(trace.events);
+  free(trace.data);
+
+  return ret;
+}
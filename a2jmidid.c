@@ -25,6 +25,11 @@
 #include <stdbool.h>
 #include <sys/stat.h>
 #include <pthread.h>
+#include <unistd.h>
+#include <errno.h>
+#include <ctype.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
 
 #include <alsa/asoundlib.h>
 
@@ -42,8 +47,10 @@
 #include "structs.h"
 #include "port.h"
 #include "port_thread.h"
-#include "port_hash.h"
+#include "port_table.h"
 #include "log.h"
+#include "memlock.h"
+#include "trace.h"
 #if HAVE_DBUS_1
 # include "dbus.h"
 #endif
@@ -65,7 +72,18 @@ size_t g_max_jack_port_name_size;
 bool g_disable_port_uniqueness = false;
 
 bool g_a2j_export_hw_ports = false;
+bool g_a2j_kernel_scheduling = false;
+size_t g_a2j_output_buffer_size = 0; /* 0 means alsa-lib default */
+unsigned int g_a2j_spin_usecs = 0; /* busy wait this long before output deadlines, 0 disables */
+size_t g_a2j_max_event_size = A2J_DEFAULT_MAX_OUTBOUND_EVENT_SIZE; /* larger JACK events are not sent to ALSA */
+bool g_a2j_lock_memory = false;
+bool g_a2j_raw_input = false;
+unsigned int g_a2j_input_delay = 0; /* frames from ALSA arrival to JACK delivery, 0 means one period */
+bool g_a2j_input_delay_adaptive = false;
+unsigned int g_a2j_output_delay = 0; /* frames from JACK time to ALSA delivery, 0 means as soon as possible */
+bool g_a2j_output_delay_period = false; /* one period instead of g_a2j_output_delay */
 char * g_a2j_jack_server_name = "default";
+char * g_a2j_trace_path = NULL;
 
 static
 void
@@ -83,16 +101,9 @@ a2j_stream_init(
 {
   struct a2j_stream *str = &self->stream[dir];
 
-  str->new_ports = jack_ringbuffer_create(MAX_PORTS * sizeof(struct a2j_port *));
-  if (str->new_ports == NULL)
-  {
-    return false;
-  }
-
-  snd_midi_event_new(MAX_EVENT_SIZE, &str->codec);
   INIT_LIST_HEAD(&str->list);
 
-  return true;
+  return a2j_port_slab_init(str, dir);
 }
 
 static
@@ -105,15 +116,20 @@ a2j_stream_attach(
 static
 void
 a2j_stream_detach(
+  struct a2j * self,
   struct a2j_stream * stream_ptr)
 {
   struct a2j_port * port_ptr;
   struct list_head * node_ptr;
 
+  a2j_free_port_arrays(stream_ptr);
+
   while (!list_empty(&stream_ptr->list))
   {
     node_ptr = stream_ptr->list.next;
+    pthread_mutex_lock(&self->ports_lock);
     list_del(node_ptr);
+    pthread_mutex_unlock(&self->ports_lock);
     port_ptr = list_entry(node_ptr, struct a2j_port, siblings);
     a2j_info("port deleted: %s", port_ptr->name);
     a2j_port_free(port_ptr);
@@ -128,10 +144,8 @@ a2j_stream_close(
 {
   struct a2j_stream *str = &self->stream[dir];
 
-  if (str->codec)
-    snd_midi_event_free(str->codec);
-  if (str->new_ports)
-    jack_ringbuffer_free(str->new_ports);
+  a2j_port_table_free(str->port_table);
+  a2j_slab_uninit(&str->port_slab);
 }
 
 struct a2j * a2j_new(void)
@@ -147,6 +161,17 @@ struct a2j * a2j_new(void)
     goto fail;
   }
 
+  if (g_a2j_lock_memory)
+  {
+    a2j_memlock_init();
+  }
+
+  self->backend = g_a2j_backend_system;
+
+  INIT_LIST_HEAD(&self->zombie_ports);
+  pthread_mutex_init(&self->ports_lock, NULL);
+  a2j_histogram_reset(&self->output_lateness);
+
   self->port_add = jack_ringbuffer_create(2 * MAX_PORTS * sizeof(snd_seq_addr_t));
   if (self->port_add == NULL)
   {
@@ -159,15 +184,19 @@ struct a2j * a2j_new(void)
     goto free_ringbuffer_add;
   }
 
-  self->outbound_events = jack_ringbuffer_create(MAX_EVENT_SIZE * 16 * sizeof(struct a2j_delivery_event));
-  if (self->outbound_events == NULL)
+  if (!a2j_sysex_pool_init(&self->sysex_pool, A2J_SYSEX_POOL_SIZE, g_a2j_max_event_size, g_a2j_lock_memory))
   {
     goto free_ringbuffer_del;
   }
 
+  if (!a2j_sysex_pool_init(&self->sysex_out_pool, A2J_SYSEX_POOL_SIZE, g_a2j_max_event_size, g_a2j_lock_memory))
+  {
+    goto free_sysex_pool;
+  }
+
   if (!a2j_stream_init(self, A2J_PORT_CAPTURE))
   {
-    goto free_ringbuffer_outbound;
+    goto free_sysex_out_pool;
   }
 
   if (!a2j_stream_init(self, A2J_PORT_PLAYBACK))
@@ -203,6 +232,16 @@ struct a2j * a2j_new(void)
     goto close_seq_client;
   }
 
+  if (g_a2j_output_buffer_size != 0)
+  {
+    /* events due in the same window are buffered here and written with one drain */
+    error = snd_seq_set_output_buffer_size(self->seq, g_a2j_output_buffer_size);
+    if (error < 0)
+    {
+      a2j_warning("snd_seq_set_output_buffer_size(%zu) failed: %s", g_a2j_output_buffer_size, snd_strerror(error));
+    }
+  }
+
   self->client_id = snd_seq_client_id(self->seq);
   if (self->client_id < 0)
   {
@@ -219,6 +258,16 @@ struct a2j * a2j_new(void)
 
   snd_seq_start_queue(self->seq, self->queue, 0); 
 
+  if (g_a2j_kernel_scheduling)
+  {
+    /* scheduled events wait in the kernel pool until they are due */
+    error = snd_seq_set_client_pool_output(self->seq, A2J_KERNEL_POOL_OUTPUT);
+    if (error < 0)
+    {
+      a2j_warning("snd_seq_set_client_pool_output() failed: %s", snd_strerror(error));
+    }
+  }
+
   a2j_stream_attach(self->stream + A2J_PORT_CAPTURE);
   a2j_stream_attach(self->stream + A2J_PORT_PLAYBACK);
 
@@ -231,25 +280,46 @@ struct a2j * a2j_new(void)
 
   snd_seq_drop_input(self->seq);
 
-  a2j_add_ports(&self->stream[A2J_PORT_CAPTURE]);
-  a2j_add_ports(&self->stream[A2J_PORT_PLAYBACK]);
-
   self->jack_client = a2j_jack_client_create(self, A2J_JACK_CLIENT_NAME, g_a2j_jack_server_name);
   if (self->jack_client == NULL)
   {
     goto free_self;
   }
 
-  if (sem_init(&self->io_semaphore, 0, 0) < 0)
+  self->out_next_frame = A2J_OUTPUT_IDLE;
+
+  self->io_eventfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (self->io_eventfd < 0)
   {
-    a2j_error("can't create IO semaphore");
+    a2j_error("can't create IO eventfd: %s", strerror(errno));
     goto close_jack_client;
   }
 
+  self->io_timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (self->io_timerfd < 0)
+  {
+    a2j_error("can't create IO timerfd: %s", strerror(errno));
+    goto close_eventfd;
+  }
+
+  if (g_a2j_trace_path != NULL)
+  {
+    self->trace = a2j_trace_open(
+      g_a2j_trace_path,
+      self->backend.jack->get_sample_rate(self->jack_client),
+      self->backend.jack->get_buffer_size(self->jack_client),
+      g_a2j_input_delay_adaptive ? A2J_TRACE_INPUT_DELAY_ADAPTIVE : g_a2j_input_delay,
+      g_a2j_lock_memory);
+    if (self->trace == NULL)
+    {
+      goto close_timerfd;
+    }
+  }
+
   if (jack_activate(self->jack_client))
   {
     a2j_error("can't activate jack client");
-    goto sem_destroy;
+    goto close_trace;
   }
 
   g_keep_alsa_walking = true;
@@ -257,7 +327,7 @@ struct a2j * a2j_new(void)
   if (pthread_create(&self->alsa_input_thread, NULL, a2j_alsa_input_thread, self) < 0)
   {
     a2j_error("cannot start ALSA input thread");
-    goto sem_destroy;
+    goto deactivate;
   }
 
   /* wake the poll loop in the alsa input thread so initial ports are fetched */
@@ -274,6 +344,11 @@ struct a2j * a2j_new(void)
     goto disconnect;
   }
 
+  if (g_a2j_lock_memory)
+  {
+    a2j_memlock_report();
+  }
+
   return self;
 
 disconnect:
@@ -281,8 +356,17 @@ disconnect:
   snd_seq_disconnect_from(self->seq, self->port_id, SND_SEQ_CLIENT_SYSTEM, SND_SEQ_PORT_SYSTEM_ANNOUNCE);
 join_input_thread:
   pthread_join(self->alsa_input_thread, &thread_status);
-sem_destroy:
-  sem_destroy(&self->io_semaphore);
+deactivate:
+  jack_deactivate(self->jack_client);
+close_trace:
+  if (self->trace != NULL)
+  {
+    a2j_trace_close(self->trace);
+  }
+close_timerfd:
+  close(self->io_timerfd);
+close_eventfd:
+  close(self->io_eventfd);
 close_jack_client:
   error = jack_client_close(self->jack_client);
   if (error != 0)
@@ -295,22 +379,73 @@ close_playback_stream:
   a2j_stream_close(self, A2J_PORT_PLAYBACK);
 close_capture_stream:
   a2j_stream_close(self, A2J_PORT_CAPTURE);
-free_ringbuffer_outbound:
-  jack_ringbuffer_free(self->outbound_events);
+free_sysex_out_pool:
+  a2j_sysex_pool_uninit(&self->sysex_out_pool);
+free_sysex_pool:
+  a2j_sysex_pool_uninit(&self->sysex_pool);
 free_ringbuffer_del:
   jack_ringbuffer_free(self->port_del);
 free_ringbuffer_add:
   jack_ringbuffer_free(self->port_add);
 free_self:
+  pthread_mutex_destroy(&self->ports_lock);
   free(self);
 fail:
   return NULL;
 }
 
+/* page faults of the jack process thread counted from the first main loop pass it was running in */
+static
+void
+a2j_rt_faults_sample(
+  struct a2j * self)
+{
+  pid_t tid;
+
+  tid = __atomic_load_n(&self->rt_tid, __ATOMIC_ACQUIRE);
+  if (self->rt_faults_sampled || tid == 0)
+  {
+    return;
+  }
+
+  self->rt_faults_sampled = a2j_thread_faults(tid, &self->rt_minflt_start, &self->rt_majflt_start);
+}
+
+bool
+a2j_rt_faults(
+  struct a2j * self,
+  unsigned long * minor_ptr,
+  unsigned long * major_ptr)
+{
+  if (!self->rt_faults_sampled || !a2j_thread_faults(self->rt_tid, minor_ptr, major_ptr))
+  {
+    return false;
+  }
+
+  *minor_ptr -= self->rt_minflt_start;
+  *major_ptr -= self->rt_majflt_start;
+  return true;
+}
+
+static
+void
+a2j_rt_faults_log(
+  struct a2j * self)
+{
+  unsigned long minor;
+  unsigned long major;
+
+  if (a2j_rt_faults(self, &minor, &major))
+  {
+    a2j_info("JACK process thread page faults in steady state: %lu minor, %lu major", minor, major);
+  }
+}
+
 static void a2j_destroy(struct a2j * self)
 {
   int error;
   void * thread_status;
+  struct list_head * node_ptr;
 
   a2j_debug("midi: delete");
 
@@ -320,17 +455,37 @@ static void a2j_destroy(struct a2j * self)
   snd_seq_disconnect_from(self->seq, self->port_id, SND_SEQ_CLIENT_SYSTEM, SND_SEQ_PORT_SYSTEM_ANNOUNCE);
   pthread_join(self->alsa_input_thread, &thread_status);
 
-  /* wake output thread and join, then destroy the semaphore */
-  sem_post(&self->io_semaphore);
+  /* wake output thread and join */
+  a2j_wake_output_thread(self);
   pthread_join(self->alsa_output_thread, &thread_status);
-  sem_destroy(&self->io_semaphore);
 
   jack_ringbuffer_reset(self->port_add);
 
+  if (g_a2j_lock_memory)
+  {
+    a2j_rt_faults_log(self);
+  }
+
   jack_deactivate(self->jack_client);
 
-  a2j_stream_detach(self->stream + A2J_PORT_CAPTURE);
-  a2j_stream_detach(self->stream + A2J_PORT_PLAYBACK);
+  /* jack process may write to io_eventfd until it is deactivated */
+  close(self->io_timerfd);
+  close(self->io_eventfd);
+
+  if (self->trace != NULL)
+  {
+    a2j_trace_close(self->trace);
+  }
+
+  a2j_stream_detach(self, self->stream + A2J_PORT_CAPTURE);
+  a2j_stream_detach(self, self->stream + A2J_PORT_PLAYBACK);
+
+  while (!list_empty(&self->zombie_ports))
+  {
+    node_ptr = self->zombie_ports.next;
+    list_del(node_ptr);
+    a2j_port_free(list_entry(node_ptr, struct a2j_port, siblings));
+  }
 
   error = jack_client_close(self->jack_client);
   if (error != 0)
@@ -344,10 +499,14 @@ static void a2j_destroy(struct a2j * self)
   a2j_stream_close(self, A2J_PORT_PLAYBACK);
   a2j_stream_close(self, A2J_PORT_CAPTURE);
 
-  jack_ringbuffer_free(self->outbound_events);
   jack_ringbuffer_free(self->port_add);
   jack_ringbuffer_free(self->port_del);
 
+  a2j_sysex_pool_uninit(&self->sysex_pool);
+  a2j_sysex_pool_uninit(&self->sysex_out_pool);
+
+  pthread_mutex_destroy(&self->ports_lock);
+
   free(self);
 }
 
@@ -365,6 +524,8 @@ bool a2j_start(void)
 
   a2j_info("Hardware ports %s be exported.", g_a2j_export_hw_ports ? "will": "will not");
 
+  a2j_info("Output events %s scheduled on the ALSA sequencer queue.", g_a2j_kernel_scheduling ? "will be": "will not be");
+
   g_a2j = a2j_new();
   if (g_a2j == NULL)
   {
@@ -419,12 +580,41 @@ a2j_is_started()
   return g_started;
 }
 
+#define A2J_OUTPUT_BUFFER_SIZE_LIMIT (16 * 1024 * 1024)
+#define A2J_SPIN_USECS_LIMIT 10000
+#define A2J_DELAY_FRAMES_LIMIT 65536
+
+/* whole decimal number within [min, max], anything else is refused */
+static
+bool
+a2j_parse_number(
+  const char * option,
+  const char * str,
+  unsigned long min,
+  unsigned long max,
+  unsigned long * value_ptr)
+{
+  char * end;
+  unsigned long value;
+
+  errno = 0;
+  value = strtoul(str, &end, 10);
+  if (!isdigit((unsigned char)str[0]) || *end != 0 || errno != 0 || value < min || value > max)
+  {
+    a2j_error("Invalid value '%s' for %s, expected a number from %lu to %lu", str, option, min, max);
+    return false;
+  }
+
+  *value_ptr = value;
+  return true;
+}
+
 static
 void
 a2j_help(
   const char * self)
 {
-  a2j_info("Usage: %s [-j jack-server] [-e | --export-hw] [-u]", self);
+  a2j_info("Usage: %s [-j jack-server] [-e | --export-hw] [-u] [-k | --kernel-scheduling] [-b | --output-buffer-size bytes] [-s | --spin-usecs usecs] [-m | --max-event-size bytes] [-l | --lock-memory] [-t | --trace file] [-r | --raw-input] [-i | --input-delay frames|period|adaptive] [-o | --output-delay frames|period]", self);
   a2j_info("Defaults:");
   a2j_info("-j default");
 }
@@ -465,11 +655,25 @@ main(
 
   if (!dbus)
   {
-    struct option long_opts[] = { { "export-hw", 0, 0, 'e' }, { 0, 0, 0, 0 } };
+    struct option long_opts[] =
+      {
+        { "export-hw", 0, 0, 'e' },
+        { "kernel-scheduling", 0, 0, 'k' },
+        { "output-buffer-size", 1, 0, 'b' },
+        { "spin-usecs", 1, 0, 's' },
+        { "max-event-size", 1, 0, 'm' },
+        { "lock-memory", 0, 0, 'l' },
+        { "trace", 1, 0, 't' },
+        { "raw-input", 0, 0, 'r' },
+        { "input-delay", 1, 0, 'i' },
+        { "output-delay", 1, 0, 'o' },
+        { 0, 0, 0, 0 }
+      };
 
     int option_index = 0;
     int c;
-    while ((c = getopt_long(argc, argv, "j:eu", long_opts, &option_index)) != -1)
+    unsigned long number;
+    while ((c = getopt_long(argc, argv, "j:eukb:s:m:lt:ri:o:", long_opts, &option_index)) != -1)
     {
       switch (c)
       {
@@ -482,6 +686,76 @@ main(
       case 'u':
         g_disable_port_uniqueness = true;
         break;
+      case 'k':
+        g_a2j_kernel_scheduling = true;
+        break;
+      case 'b':
+        if (!a2j_parse_number("--output-buffer-size", optarg, 1, A2J_OUTPUT_BUFFER_SIZE_LIMIT, &number))
+        {
+          a2j_help(argv[0]);
+          return 1;
+        }
+        g_a2j_output_buffer_size = number;
+        break;
+      case 's':
+        if (!a2j_parse_number("--spin-usecs", optarg, 1, A2J_SPIN_USECS_LIMIT, &number))
+        {
+          a2j_help(argv[0]);
+          return 1;
+        }
+        g_a2j_spin_usecs = number;
+        break;
+      case 'm':
+        if (!a2j_parse_number("--max-event-size", optarg, 1, A2J_MAX_OUTBOUND_EVENT_SIZE_LIMIT, &number))
+        {
+          a2j_help(argv[0]);
+          return 1;
+        }
+        g_a2j_max_event_size = number;
+        break;
+      case 'l':
+        g_a2j_lock_memory = true;
+        break;
+      case 't':
+        g_a2j_trace_path = strdup(optarg);
+        break;
+      case 'r':
+        g_a2j_raw_input = true;
+        break;
+      case 'i':
+        if (strcmp(optarg, "adaptive") == 0)
+        {
+          g_a2j_input_delay_adaptive = true;
+        }
+        else if (strcmp(optarg, "period") == 0)
+        {
+          g_a2j_input_delay = 0;
+        }
+        else if (a2j_parse_number("--input-delay", optarg, 1, A2J_DELAY_FRAMES_LIMIT, &number))
+        {
+          g_a2j_input_delay = number;
+        }
+        else
+        {
+          a2j_help(argv[0]);
+          return 1;
+        }
+        break;
+      case 'o':
+        if (strcmp(optarg, "period") == 0)
+        {
+          g_a2j_output_delay_period = true;
+        }
+        else if (a2j_parse_number("--output-delay", optarg, 0, A2J_DELAY_FRAMES_LIMIT, &number))
+        {
+          g_a2j_output_delay = number;
+        }
+        else
+        {
+          a2j_help(argv[0]);
+          return 1;
+        }
+        break;
       default:
         a2j_help(argv[0]);
         return 1;        
@@ -572,8 +846,20 @@ main(
 
     if (g_started)
     {
-      a2j_free_ports(g_a2j->port_del);
+      a2j_free_ports(g_a2j);
       a2j_update_ports(g_a2j);
+      a2j_reclaim_ports(g_a2j);
+      a2j_jack_update_latency(g_a2j);
+
+      if (g_a2j_lock_memory)
+      {
+        a2j_rt_faults_sample(g_a2j);
+      }
+
+      if (g_a2j->trace != NULL)
+      {
+        a2j_trace_flush(g_a2j->trace);
+      }
     }
   }
 
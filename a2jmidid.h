@@ -25,6 +25,15 @@ bool a2j_start(void);
 bool a2j_stop(void);
 bool a2j_is_started(void);
 
+struct a2j;
+
+/* page faults of the jack process thread since it was first seen running, --lock-memory only */
+bool
+a2j_rt_faults(
+  struct a2j * self,
+  unsigned long * minor_ptr,
+  unsigned long * major_ptr);
+
 void * a2j_alsa_input_thread(void * arg);
 void * a2j_alsa_output_thread(void * arg);
 
@@ -0,0 +1,136 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * ALSA SEQ < - > JACK MIDI bridge
+ *
+ * Copyright (c) 2026 The a2jmidid authors
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <poll.h>
+#include <alsa/asoundlib.h>
+#include <jack/jack.h>
+#include <jack/midiport.h>
+
+#include "backend.h"
+
+static
+jack_client_t *
+a2j_system_client_open(
+  const char * client_name,
+  jack_options_t options,
+  jack_status_t * status,
+  const char * server_name)
+{
+  if (options & JackServerName)
+  {
+    return jack_client_open(client_name, options, status, server_name);
+  }
+
+  return jack_client_open(client_name, options, status);
+}
+
+static
+int
+a2j_system_free_event(
+  snd_seq_t * seq,
+  snd_seq_event_t * ev)
+{
+  return snd_seq_free_event(ev);
+}
+
+static
+int
+a2j_system_get_queue_real_time(
+  snd_seq_t * seq,
+  int q,
+  snd_seq_real_time_t * time)
+{
+  snd_seq_queue_status_t * status;
+  int err;
+
+  snd_seq_queue_status_alloca(&status);
+
+  err = snd_seq_get_queue_status(seq, q, status);
+  if (err < 0)
+  {
+    return err;
+  }
+
+  *time = *snd_seq_queue_status_get_real_time(status);
+  return 0;
+}
+
+static const struct a2j_jack_ops g_a2j_jack_ops_system =
+{
+  .client_open = a2j_system_client_open,
+  .get_buffer_size = jack_get_buffer_size,
+  .get_sample_rate = jack_get_sample_rate,
+
+  .set_process_callback = jack_set_process_callback,
+  .set_thread_init_callback = jack_set_thread_init_callback,
+  .set_freewheel_callback = jack_set_freewheel_callback,
+  .set_buffer_size_callback = jack_set_buffer_size_callback,
+  .set_latency_callback = jack_set_latency_callback,
+  .on_shutdown = jack_on_shutdown,
+
+  .port_register = jack_port_register,
+  .port_unregister = jack_port_unregister,
+  .port_get_buffer = jack_port_get_buffer,
+  .port_name = jack_port_name,
+  .port_set_latency_range = jack_port_set_latency_range,
+  .recompute_total_latencies = jack_recompute_total_latencies,
+
+  .get_time = jack_get_time,
+  .frame_time = jack_frame_time,
+  .last_frame_time = jack_last_frame_time,
+  .frames_to_time = jack_frames_to_time,
+  .get_cycle_times = jack_get_cycle_times,
+
+  .midi_clear_buffer = jack_midi_clear_buffer,
+  .midi_get_event_count = jack_midi_get_event_count,
+  .midi_event_get = jack_midi_event_get,
+  .midi_max_event_size = jack_midi_max_event_size,
+  .midi_event_reserve = jack_midi_event_reserve,
+};
+
+static const struct a2j_seq_ops g_a2j_seq_ops_system =
+{
+  .get_any_client_info = snd_seq_get_any_client_info,
+  .get_any_port_info = snd_seq_get_any_port_info,
+  .query_next_client = snd_seq_query_next_client,
+  .query_next_port = snd_seq_query_next_port,
+  .connect_to = snd_seq_connect_to,
+  .subscribe_port = snd_seq_subscribe_port,
+
+  .type = snd_seq_type,
+  .get_input_buffer_size = snd_seq_get_input_buffer_size,
+  .poll_descriptors_count = snd_seq_poll_descriptors_count,
+  .poll_descriptors = snd_seq_poll_descriptors,
+
+  .event_input = snd_seq_event_input,
+  .free_event = a2j_system_free_event,
+  .event_output = snd_seq_event_output,
+  .drain_output = snd_seq_drain_output,
+
+  .get_queue_real_time = a2j_system_get_queue_real_time,
+};
+
+const struct a2j_backend g_a2j_backend_system =
+{
+  .jack = &g_a2j_jack_ops_system,
+  .seq = &g_a2j_seq_ops_system,
+};
@@ -0,0 +1,96 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * ALSA SEQ < - > JACK MIDI bridge
+ *
+ * Copyright (c) 2026 The a2jmidid authors
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ */
+
+#ifndef BACKEND_H__5B0E4C1D_7A26_4F3B_9D84_2E61C3A7F095__INCLUDED
+#define BACKEND_H__5B0E4C1D_7A26_4F3B_9D84_2E61C3A7F095__INCLUDED
+
+/* The calls the bridge code makes on its JACK client and sequencer
+ * handle. a2jmidid runs on the libjack and alsa-lib ones below; the
+ * benchmarks and a2j_trace run the same code on an in-process server and
+ * sequencer (bench/mock.h). Library helpers that need neither, like the
+ * ringbuffer, the info containers and the MIDI event codec, are called
+ * directly, and so is the client and sequencer setup in a2jmidid.c. */
+
+struct a2j_jack_ops
+{
+  jack_client_t * (* client_open)(const char * client_name, jack_options_t options, jack_status_t * status, const char * server_name);
+  jack_nframes_t (* get_buffer_size)(jack_client_t * client);
+  jack_nframes_t (* get_sample_rate)(jack_client_t * client);
+
+  int (* set_process_callback)(jack_client_t * client, JackProcessCallback callback, void * arg);
+  int (* set_thread_init_callback)(jack_client_t * client, JackThreadInitCallback callback, void * arg);
+  int (* set_freewheel_callback)(jack_client_t * client, JackFreewheelCallback callback, void * arg);
+  int (* set_buffer_size_callback)(jack_client_t * client, JackBufferSizeCallback callback, void * arg);
+  int (* set_latency_callback)(jack_client_t * client, JackLatencyCallback callback, void * arg);
+  void (* on_shutdown)(jack_client_t * client, JackShutdownCallback callback, void * arg);
+
+  jack_port_t * (* port_register)(jack_client_t * client, const char * port_name, const char * port_type, unsigned long flags, unsigned long buffer_size);
+  int (* port_unregister)(jack_client_t * client, jack_port_t * port);
+  void * (* port_get_buffer)(jack_port_t * port, jack_nframes_t nframes);
+  const char * (* port_name)(const jack_port_t * port);
+  void (* port_set_latency_range)(jack_port_t * port, jack_latency_callback_mode_t mode, jack_latency_range_t * range);
+  int (* recompute_total_latencies)(jack_client_t * client);
+
+  jack_time_t (* get_time)(void);
+  jack_nframes_t (* frame_time)(const jack_client_t * client);
+  jack_nframes_t (* last_frame_time)(const jack_client_t * client);
+  jack_time_t (* frames_to_time)(const jack_client_t * client, jack_nframes_t frames);
+  int (* get_cycle_times)(const jack_client_t * client, jack_nframes_t * current_frames, jack_time_t * current_usecs, jack_time_t * next_usecs, float * period_usecs);
+
+  void (* midi_clear_buffer)(void * port_buffer);
+  uint32_t (* midi_get_event_count)(void * port_buffer);
+  int (* midi_event_get)(jack_midi_event_t * event, void * port_buffer, uint32_t event_index);
+  size_t (* midi_max_event_size)(void * port_buffer);
+  jack_midi_data_t * (* midi_event_reserve)(void * port_buffer, jack_nframes_t time, size_t data_size);
+};
+
+struct a2j_seq_ops
+{
+  int (* get_any_client_info)(snd_seq_t * seq, int client, snd_seq_client_info_t * info);
+  int (* get_any_port_info)(snd_seq_t * seq, int client, int port, snd_seq_port_info_t * info);
+  int (* query_next_client)(snd_seq_t * seq, snd_seq_client_info_t * info);
+  int (* query_next_port)(snd_seq_t * seq, snd_seq_port_info_t * info);
+  int (* connect_to)(snd_seq_t * seq, int my_port, int dest_client, int dest_port);
+  int (* subscribe_port)(snd_seq_t * seq, snd_seq_port_subscribe_t * sub);
+
+  snd_seq_type_t (* type)(snd_seq_t * seq);
+  size_t (* get_input_buffer_size)(snd_seq_t * seq);
+  int (* poll_descriptors_count)(snd_seq_t * seq, short events);
+  int (* poll_descriptors)(snd_seq_t * seq, struct pollfd * pfds, unsigned int space, short events);
+
+  int (* event_input)(snd_seq_t * seq, snd_seq_event_t ** ev);
+  /* an event event_input() returned on seq */
+  int (* free_event)(snd_seq_t * seq, snd_seq_event_t * ev);
+  int (* event_output)(snd_seq_t * seq, snd_seq_event_t * ev);
+  int (* drain_output)(snd_seq_t * seq);
+
+  /* snd_seq_get_queue_status() and the real time of the status */
+  int (* get_queue_real_time)(snd_seq_t * seq, int q, snd_seq_real_time_t * time);
+};
+
+struct a2j_backend
+{
+  const struct a2j_jack_ops * jack;
+  const struct a2j_seq_ops * seq;
+};
+
+extern const struct a2j_backend g_a2j_backend_system;
+
+#endif /* #ifndef BACKEND_H__5B0E4C1D_7A26_4F3B_9D84_2E61C3A7F095__INCLUDED */
@@ -0,0 +1,128 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * ALSA SEQ < - > JACK MIDI bridge
+ *
+ * Copyright (c) 2026 The a2jmidid authors
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ */
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "log.h"
+#include "bench.h"
+
+static unsigned int g_bench_results;
+static uint32_t g_bench_random = 2463534242u;
+
+uint64_t
+a2j_bench_nsecs(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void
+a2j_bench_begin(
+  const char * benchmark)
+{
+  g_bench_results = 0;
+  printf("{\"benchmark\": \"%s\", \"results\": [", benchmark);
+}
+
+void
+a2j_bench_result(
+  const char * name,
+  const char * unit,
+  double value,
+  const char * parameters_format,
+  ...)
+{
+  va_list ap;
+
+  printf("%s\n  {\"name\": \"%s\", \"unit\": \"%s\", \"value\": %.3f", g_bench_results++ == 0 ? "" : ",", name, unit, value);
+
+  if (parameters_format != NULL)
+  {
+    printf(", ");
+    va_start(ap, parameters_format);
+    vprintf(parameters_format, ap);
+    va_end(ap);
+  }
+
+  printf("}");
+}
+
+void
+a2j_bench_end(void)
+{
+  printf("\n]}\n");
+  fflush(stdout);
+}
+
+/* xorshift32 */
+uint32_t
+a2j_bench_random(void)
+{
+  g_bench_random ^= g_bench_random << 13;
+  g_bench_random ^= g_bench_random >> 17;
+  g_bench_random ^= g_bench_random << 5;
+  return g_bench_random;
+}
+
+/* the log of the bridge code, kept out of the JSON on stdout */
+void
+a2j_log(
+  unsigned int level,
+  const char * format,
+  ...)
+{
+  va_list ap;
+
+  va_start(ap, format);
+  vfprintf(stderr, format, ap);
+  va_end(ap);
+}
+
+unsigned long
+a2j_bench_arg(
+  int argc,
+  char ** argv,
+  int index,
+  unsigned long value)
+{
+  char * end;
+  unsigned long arg;
+
+  if (index >= argc)
+  {
+    return value;
+  }
+
+  arg = strtoul(argv[index], &end, 10);
+  if (*end != 0 || arg == 0)
+  {
+    fprintf(stderr, "ignoring argument '%s', using %lu\n", argv[index], value);
+    return value;
+  }
+
+  return arg;
+}
@@ -0,0 +1,59 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * ALSA SEQ < - > JACK MIDI bridge
+ *
+ * Copyright (c) 2026 The a2jmidid authors
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ */
+
+#ifndef BENCH_H__014E8AF0_1888_4F10_BF19_3F067BDC26B9__INCLUDED
+#define BENCH_H__014E8AF0_1888_4F10_BF19_3F067BDC26B9__INCLUDED
+
+/* Each benchmark prints one JSON object on stdout,
+ *   {"benchmark": name, "results": [{"name": ..., "unit": ..., "value": ..., parameters...}, ...]}
+ * so runs can be compared by a script. Diagnostics go to stderr. */
+
+uint64_t
+a2j_bench_nsecs(void);
+
+void
+a2j_bench_begin(
+  const char * benchmark);
+
+/* parameters_format, if not NULL, formats extra members of the result object */
+void
+a2j_bench_result(
+  const char * name,
+  const char * unit,
+  double value,
+  const char * parameters_format,
+  ...) __attribute__((format(printf, 4, 5)));
+
+void
+a2j_bench_end(void);
+
+/* the same sequence in every run */
+uint32_t
+a2j_bench_random(void);
+
+/* argv[index] as a positive number, default if absent */
+unsigned long
+a2j_bench_arg(
+  int argc,
+  char ** argv,
+  int index,
+  unsigned long value);
+
+#endif /* #ifndef BENCH_H__014E8AF0_1888_4F10_BF19_3F067BDC26B9__INCLUDED */
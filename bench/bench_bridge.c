@@ -0,0 +1,496 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * ALSA SEQ < - > JACK MIDI bridge
+ *
+ * Copyright (c) 2026 The a2jmidid authors
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ */
+
+/* Throughput of the bridge on the mock JACK server and sequencer:
+ * events injected into the sequencer at a fixed number per period go
+ * through the ALSA input thread and the process cycle into the JACK
+ * capture ports, events queued in the JACK playback ports go through
+ * the process cycle and the ALSA output thread into the sequencer.
+ * Input events with and without queue timestamps, mixed on one port,
+ * must reach the JACK port in time order; the exit status is 1 if not.
+ * With lock_memory 1 memory is locked like --lock-memory does, and the
+ * exit status is also 1 if any thread takes a major page fault after
+ * the first pass warmed everything up.
+ *
+ * bench_bridge [ports [events_per_cycle [cycles [nframes [output_buffer_size [lock_memory]]]]]] */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <alsa/asoundlib.h>
+#include <jack/jack.h>
+#include <jack/midiport.h>
+#include <jack/ringbuffer.h>
+
+#include "list.h"
+#include "structs.h"
+#include "port_thread.h"
+#include "conf.h"
+#include "memlock.h"
+#include "mock.h"
+#include "bench.h"
+
+#define A2J_BENCH_LATE_CYCLES  16          /* events not delivered after this many cycles are lost */
+#define A2J_BENCH_OUTPUT_NSECS 1000000000  /* how long to wait for the output thread */
+
+#define A2J_BENCH_PARAMETERS(bench_ptr) \
+  "\"ports\": %u, \"events_per_cycle\": %u, \"nframes\": %u", \
+  (bench_ptr)->ports, (bench_ptr)->events, (unsigned int)(bench_ptr)->nframes
+
+struct a2j_bench_bridge
+{
+  struct a2j * a2j_ptr;
+  unsigned int ports;
+  unsigned int events;          /* per cycle */
+  unsigned int cycles;
+  jack_nframes_t nframes;
+  jack_port_t ** capture;       /* the JACK ports of the client ports, by index */
+  jack_port_t ** playback;
+};
+
+static
+uint64_t
+a2j_bench_delivered(
+  struct a2j_bench_bridge * bench_ptr)
+{
+  uint64_t count;
+  unsigned int i;
+
+  count = 0;
+  for (i = 0; i < bench_ptr->ports; i++)
+  {
+    count += a2j_mock_jack_midi_count(bench_ptr->capture[i]);
+  }
+
+  return count;
+}
+
+static
+void
+a2j_bench_input(
+  struct a2j_bench_bridge * bench_ptr)
+{
+  snd_seq_event_t * batch;
+  snd_seq_t * seq;
+  unsigned int cycle;
+  unsigned int i;
+  unsigned int late;
+  uint64_t start;
+  uint64_t input_nsecs;
+  uint64_t process_nsecs;
+  uint64_t injected;
+  uint64_t delivered;
+  uint64_t pending;
+  uint64_t count;
+  uint64_t latency;
+
+  batch = malloc(bench_ptr->events * sizeof(snd_seq_event_t));
+  if (batch == NULL)
+  {
+    return;
+  }
+
+  seq = bench_ptr->a2j_ptr->seq;
+  input_nsecs = 0;
+  process_nsecs = 0;
+  injected = 0;
+  delivered = 0;
+  latency = 0;
+
+  for (cycle = 0; cycle < bench_ptr->cycles; cycle++)
+  {
+    for (i = 0; i < bench_ptr->events; i++)
+    {
+      snd_seq_ev_clear(batch + i);
+      batch[i].source = a2j_mock_bridge_addr((cycle * bench_ptr->events + i) % bench_ptr->ports);
+      batch[i].dest.client = A2J_MOCK_CLIENT_ID;
+      batch[i].dest.port = 0;
+      snd_seq_ev_set_direct(batch + i);
+      snd_seq_ev_set_noteon(batch + i, 0, i % 128, 100);
+    }
+
+    start = a2j_bench_nsecs();
+    pending = a2j_mock_seq_inject(seq, batch, bench_ptr->events);
+    while (a2j_mock_seq_pending(seq) != 0)
+    {
+      sched_yield();
+    }
+    input_nsecs += a2j_bench_nsecs() - start;
+    injected += pending;
+
+    /* with the default input delay the batch is due in the next cycle */
+    for (late = 1; pending > 0 && late <= A2J_BENCH_LATE_CYCLES; late++)
+    {
+      start = a2j_bench_nsecs();
+      a2j_mock_jack_cycle();
+      process_nsecs += a2j_bench_nsecs() - start;
+
+      count = a2j_bench_delivered(bench_ptr);
+      count = count > pending ? pending : count;
+      pending -= count;
+      delivered += count;
+      latency += count * late;
+    }
+  }
+
+  free(batch);
+
+  a2j_bench_result("input thread", "ns/event", injected ? (double)input_nsecs / injected : 0, A2J_BENCH_PARAMETERS(bench_ptr));
+  a2j_bench_result("process incoming", "ns/event", delivered ? (double)process_nsecs / delivered : 0, A2J_BENCH_PARAMETERS(bench_ptr));
+  a2j_bench_result("input latency", "cycles", delivered ? (double)latency / delivered : 0, A2J_BENCH_PARAMETERS(bench_ptr));
+  a2j_bench_result("input lost", "events", injected - delivered, A2J_BENCH_PARAMETERS(bench_ptr));
+}
+
+static
+uint64_t
+a2j_bench_dropped_jack_buffer(
+  struct a2j_bench_bridge * bench_ptr)
+{
+  struct a2j_port_stats stats;
+  uint64_t count;
+  unsigned int i;
+
+  count = 0;
+  for (i = 0; i < bench_ptr->ports; i++)
+  {
+    a2j_port_stats_read(&a2j_mock_bridge_port(bench_ptr->a2j_ptr, A2J_PORT_CAPTURE, i)->stats, &stats);
+    count += stats.dropped_jack_buffer;
+  }
+
+  return count;
+}
+
+/* runs of events on one port, direct ones between ones stamped with the
+   queue real time up to two periods back. an event mapped before the one
+   ahead of it would be rejected by the JACK port buffer, returns false if
+   any was */
+static
+bool
+a2j_bench_input_mixed(
+  struct a2j_bench_bridge * bench_ptr)
+{
+  snd_seq_event_t * batch;
+  snd_seq_t * seq;
+  struct timespec now;
+  unsigned int cycle;
+  unsigned int i;
+  unsigned int late;
+  uint64_t now_nsecs;
+  uint64_t stamp;
+  uint64_t period_nsecs;
+  uint64_t injected;
+  uint64_t delivered;
+  uint64_t pending;
+  uint64_t count;
+  uint64_t dropped;
+
+  batch = malloc(bench_ptr->events * sizeof(snd_seq_event_t));
+  if (batch == NULL)
+  {
+    return false;
+  }
+
+  seq = bench_ptr->a2j_ptr->seq;
+  period_nsecs = (uint64_t)bench_ptr->nframes * 1000000000 / A2J_MOCK_SAMPLE_RATE;
+  injected = 0;
+  delivered = 0;
+  dropped = a2j_bench_dropped_jack_buffer(bench_ptr);
+
+  for (cycle = 0; cycle < bench_ptr->cycles; cycle++)
+  {
+    /* the mock queue runs on the monotonic clock */
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    now_nsecs = (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+
+    for (i = 0; i < bench_ptr->events; i++)
+    {
+      snd_seq_ev_clear(batch + i);
+      batch[i].source = a2j_mock_bridge_addr((cycle + i / 8) % bench_ptr->ports);
+      batch[i].dest.client = A2J_MOCK_CLIENT_ID;
+      batch[i].dest.port = 0;
+      snd_seq_ev_set_direct(batch + i);
+      snd_seq_ev_set_noteon(batch + i, 0, i % 128, 100);
+
+      if (a2j_bench_random() % 2 == 0)
+      {
+        stamp = now_nsecs - a2j_bench_random() % (2 * period_nsecs);
+        batch[i].queue = bench_ptr->a2j_ptr->queue;
+        batch[i].flags |= SND_SEQ_TIME_STAMP_REAL;
+        batch[i].time.time.tv_sec = stamp / 1000000000;
+        batch[i].time.time.tv_nsec = stamp % 1000000000;
+      }
+    }
+
+    pending = a2j_mock_seq_inject(seq, batch, bench_ptr->events);
+    while (a2j_mock_seq_pending(seq) != 0)
+    {
+      sched_yield();
+    }
+    injected += pending;
+
+    for (late = 1; pending > 0 && late <= A2J_BENCH_LATE_CYCLES; late++)
+    {
+      a2j_mock_jack_cycle();
+      count = a2j_bench_delivered(bench_ptr);
+      count = count > pending ? pending : count;
+      pending -= count;
+      delivered += count;
+    }
+  }
+
+  free(batch);
+
+  dropped = a2j_bench_dropped_jack_buffer(bench_ptr) - dropped;
+
+  a2j_bench_result("input mixed timestamps lost", "events", injected - delivered, A2J_BENCH_PARAMETERS(bench_ptr));
+  a2j_bench_result("input mixed timestamps out of order", "events", dropped, A2J_BENCH_PARAMETERS(bench_ptr));
+
+  return dropped == 0;
+}
+
+/* events at the start of the period are due right away and leave in one
+   window, spread ones are due at their frame over the whole period */
+static
+void
+a2j_bench_output(
+  struct a2j_bench_bridge * bench_ptr,
+  bool spread)
+{
+  static const jack_midi_data_t note[3] = {0x90, 60, 100};
+  struct a2j_mock_seq_stats before;
+  struct a2j_mock_seq_stats after;
+  snd_seq_t * seq;
+  unsigned int cycle;
+  unsigned int i;
+  jack_nframes_t time;
+  uint64_t start;
+  uint64_t deadline;
+  uint64_t process_nsecs;
+  uint64_t output_nsecs;
+  uint64_t queued;
+  uint64_t written;
+  uint64_t drains;
+  uint64_t writes;
+  uint64_t count;
+
+  seq = bench_ptr->a2j_ptr->seq;
+  process_nsecs = 0;
+  output_nsecs = 0;
+  queued = 0;
+  written = 0;
+  drains = 0;
+  writes = 0;
+
+  for (cycle = 0; cycle < bench_ptr->cycles; cycle++)
+  {
+    count = 0;
+    for (i = 0; i < bench_ptr->events; i++)
+    {
+      time = spread ? (uint64_t)i * bench_ptr->nframes / bench_ptr->events : 0;
+      if (a2j_mock_jack_midi_add(bench_ptr->playback[(cycle * bench_ptr->events + i) % bench_ptr->ports], time, note, sizeof(note)))
+      {
+        count++;
+      }
+    }
+    queued += count;
+
+    a2j_mock_seq_stats(seq, &before);
+
+    start = a2j_bench_nsecs();
+    a2j_mock_jack_cycle();
+    process_nsecs += a2j_bench_nsecs() - start;
+
+    start = a2j_bench_nsecs();
+    deadline = start + A2J_BENCH_OUTPUT_NSECS;
+    do
+    {
+      a2j_mock_seq_stats(seq, &after);
+      if (after.output_events - before.output_events >= count && after.writes - before.writes > 0)
+      {
+        break;
+      }
+      sched_yield();
+    } while (a2j_bench_nsecs() < deadline);
+    output_nsecs += a2j_bench_nsecs() - start;
+
+    written += after.output_events - before.output_events;
+    drains += after.drains - before.drains;
+    writes += after.writes - before.writes;
+  }
+
+  if (!spread)
+  {
+    a2j_bench_result("process outgoing", "ns/event", queued ? (double)process_nsecs / queued : 0, A2J_BENCH_PARAMETERS(bench_ptr));
+    a2j_bench_result("output thread", "ns/event", written ? (double)output_nsecs / written : 0, A2J_BENCH_PARAMETERS(bench_ptr));
+  }
+
+  a2j_bench_result(spread ? "output drains spread" : "output drains", "drains/event", written ? (double)drains / written : 0, A2J_BENCH_PARAMETERS(bench_ptr));
+  a2j_bench_result(spread ? "output writes spread" : "output writes", "writes/event", written ? (double)writes / written : 0, A2J_BENCH_PARAMETERS(bench_ptr));
+  a2j_bench_result(spread ? "output lost spread" : "output lost", "events", queued - written, A2J_BENCH_PARAMETERS(bench_ptr));
+}
+
+/* the output thread before batching output and drained it after every event */
+static
+void
+a2j_bench_output_per_event(
+  struct a2j_bench_bridge * bench_ptr)
+{
+  struct a2j_mock_seq_stats before;
+  struct a2j_mock_seq_stats after;
+  snd_seq_event_t event;
+  snd_seq_t * seq;
+  uint64_t count;
+  uint64_t i;
+
+  /* a sequencer of its own, the bridge threads keep theirs busy */
+  seq = a2j_mock_seq_open();
+  if (seq == NULL)
+  {
+    return;
+  }
+
+  count = (uint64_t)bench_ptr->cycles * bench_ptr->events;
+
+  snd_seq_ev_clear(&event);
+  snd_seq_ev_set_subs(&event);
+  snd_seq_ev_set_direct(&event);
+  snd_seq_ev_set_noteon(&event, 0, 60, 100);
+
+  a2j_mock_seq_stats(seq, &before);
+  for (i = 0; i < count; i++)
+  {
+    g_a2j_mock_seq_ops.event_output(seq, &event);
+    g_a2j_mock_seq_ops.drain_output(seq);
+  }
+  a2j_mock_seq_stats(seq, &after);
+
+  a2j_mock_seq_close(seq);
+
+  a2j_bench_result("output writes per event drain", "writes/event", count ? (double)(after.writes - before.writes) / count : 0, A2J_BENCH_PARAMETERS(bench_ptr));
+}
+
+int
+main(
+  int argc,
+  char ** argv)
+{
+  struct a2j_bench_bridge bench;
+  struct a2j_port * capture_ptr;
+  struct a2j_port * playback_ptr;
+  unsigned int i;
+  bool mixed_ok;
+  bool locked;
+  struct rusage usage;
+  long majflt_start;
+  unsigned long rt_minflt_start;
+  unsigned long rt_majflt_start;
+  unsigned long rt_minflt;
+  unsigned long rt_majflt;
+  int ret;
+
+  bench.ports = a2j_bench_arg(argc, argv, 1, 16);
+  bench.events = a2j_bench_arg(argc, argv, 2, 64);
+  bench.cycles = a2j_bench_arg(argc, argv, 3, 1000);
+  bench.nframes = a2j_bench_arg(argc, argv, 4, 256);
+  g_a2j_output_buffer_size = a2j_bench_arg(argc, argv, 5, 0);
+  locked = a2j_bench_arg(argc, argv, 6, 0) != 0 && a2j_memlock_init();
+  g_a2j_lock_memory = locked;
+
+  ret = 1;
+
+  bench.capture = calloc(bench.ports, sizeof(jack_port_t *));
+  bench.playback = calloc(bench.ports, sizeof(jack_port_t *));
+  if (bench.capture == NULL || bench.playback == NULL)
+  {
+    goto free_arrays;
+  }
+
+  bench.a2j_ptr = a2j_mock_bridge_new(bench.nframes, A2J_MOCK_SAMPLE_RATE, bench.ports, true);
+  if (bench.a2j_ptr == NULL)
+  {
+    fprintf(stderr, "cannot start the bridge\n");
+    goto free_arrays;
+  }
+
+  for (i = 0; i < bench.ports; i++)
+  {
+    capture_ptr = a2j_mock_bridge_port(bench.a2j_ptr, A2J_PORT_CAPTURE, i);
+    playback_ptr = a2j_mock_bridge_port(bench.a2j_ptr, A2J_PORT_PLAYBACK, i);
+    if (capture_ptr == NULL || playback_ptr == NULL)
+    {
+      fprintf(stderr, "client port %u is not bridged\n", i);
+      goto free_bridge;
+    }
+
+    bench.capture[i] = capture_ptr->jack_port;
+    bench.playback[i] = playback_ptr->jack_port;
+  }
+
+  a2j_bench_begin("bridge");
+  a2j_bench_input(&bench);
+
+  /* the ports, rings and threads are warm now */
+  getrusage(RUSAGE_SELF, &usage);
+  majflt_start = usage.ru_majflt;
+  a2j_thread_faults(bench.a2j_ptr->rt_tid, &rt_minflt_start, &rt_majflt_start);
+
+  mixed_ok = a2j_bench_input_mixed(&bench);
+  a2j_bench_output(&bench, false);
+  a2j_bench_output(&bench, true);
+
+  getrusage(RUSAGE_SELF, &usage);
+  if (!a2j_thread_faults(bench.a2j_ptr->rt_tid, &rt_minflt, &rt_majflt))
+  {
+    rt_minflt = rt_minflt_start;
+    rt_majflt = rt_majflt_start;
+  }
+
+  a2j_bench_output_per_event(&bench);
+
+  a2j_bench_result("process thread minor faults", "faults", rt_minflt - rt_minflt_start, A2J_BENCH_PARAMETERS(&bench));
+  a2j_bench_result("process thread major faults", "faults", rt_majflt - rt_majflt_start, A2J_BENCH_PARAMETERS(&bench));
+  a2j_bench_result("major faults", "faults", usage.ru_majflt - majflt_start, A2J_BENCH_PARAMETERS(&bench));
+  a2j_bench_end();
+
+  if (locked && usage.ru_majflt != majflt_start)
+  {
+    fprintf(stderr, "major page faults after warm-up with memory locked\n");
+    goto free_bridge;
+  }
+
+  if (!mixed_ok)
+  {
+    fprintf(stderr, "events with mixed timestamps were delivered out of order\n");
+    goto free_bridge;
+  }
+
+  ret = 0;
+
+free_bridge:
+  a2j_mock_bridge_free(bench.a2j_ptr);
+free_arrays:
+  free(bench.capture);
+  free(bench.playback);
+  return ret;
+}
@@ -0,0 +1,156 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * ALSA SEQ < - > JACK MIDI bridge
+ *
+ * Copyright (c) 2026 The a2jmidid authors
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ */
+
+/* snd_midi_event_encode() and snd_midi_event_decode() on the channel
+ * and realtime messages that make up most MIDI traffic, set up like
+ * the codec of a bridge port, against a2j_midi_encode_fast() and
+ * a2j_midi_decode_fast() on the same messages.
+ *
+ * bench_codec [events] */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <alsa/asoundlib.h>
+#include <jack/jack.h>
+#include <jack/ringbuffer.h>
+
+#include "list.h"
+#include "structs.h"
+#include "midi_codec.h"
+#include "bench.h"
+
+struct a2j_bench_message
+{
+  long size;
+  unsigned char data[3];
+};
+
+static const struct a2j_bench_message g_bench_messages[] =
+{
+  {3, {0x90, 60, 100}},         /* note on */
+  {3, {0x80, 60, 64}},          /* note off */
+  {3, {0x91, 64, 90}},
+  {3, {0x81, 64, 64}},
+  {3, {0xB0, 7, 100}},          /* control change */
+  {3, {0xB0, 1, 20}},
+  {3, {0xE0, 0, 64}},           /* pitch bend */
+  {2, {0xD0, 64}},              /* channel pressure */
+  {2, {0xC0, 5}},               /* program change */
+  {1, {0xF8}},                  /* clock */
+};
+
+#define A2J_BENCH_MESSAGES (sizeof(g_bench_messages) / sizeof(g_bench_messages[0]))
+
+int
+main(
+  int argc,
+  char ** argv)
+{
+  snd_midi_event_t * codec;
+  snd_seq_event_t events[A2J_BENCH_MESSAGES];
+  unsigned char data[MAX_EVENT_SIZE];
+  unsigned long count;
+  unsigned long i;
+  unsigned int j;
+  uint64_t start;
+  double nsecs;
+  unsigned char running_status;
+  long size;
+
+  count = a2j_bench_arg(argc, argv, 1, 10000000);
+
+  if (snd_midi_event_new(MAX_EVENT_SIZE, &codec) < 0)
+  {
+    fprintf(stderr, "cannot create the MIDI codec\n");
+    return 1;
+  }
+
+  snd_midi_event_no_status(codec, 1);
+
+  a2j_bench_begin("codec");
+
+  start = a2j_bench_nsecs();
+  for (i = 0; i < count; i++)
+  {
+    j = i % A2J_BENCH_MESSAGES;
+    snd_seq_ev_clear(events + j);
+    if (snd_midi_event_encode(codec, g_bench_messages[j].data, g_bench_messages[j].size, events + j) != g_bench_messages[j].size)
+    {
+      fprintf(stderr, "message %u not encoded\n", j);
+      goto free_codec;
+    }
+  }
+  nsecs = (double)(a2j_bench_nsecs() - start) / count;
+  a2j_bench_result("snd_midi_event_encode", "ns/event", nsecs, NULL);
+
+  start = a2j_bench_nsecs();
+  for (i = 0; i < count; i++)
+  {
+    j = i % A2J_BENCH_MESSAGES;
+    size = snd_midi_event_decode(codec, data, sizeof(data), events + j);
+    if (size != g_bench_messages[j].size)
+    {
+      fprintf(stderr, "message %u decoded to %ld bytes\n", j, size);
+      goto free_codec;
+    }
+  }
+  nsecs = (double)(a2j_bench_nsecs() - start) / count;
+  a2j_bench_result("snd_midi_event_decode", "ns/event", nsecs, NULL);
+
+  running_status = 0;
+  start = a2j_bench_nsecs();
+  for (i = 0; i < count; i++)
+  {
+    j = i % A2J_BENCH_MESSAGES;
+    snd_seq_ev_clear(events + j);
+    if (a2j_midi_encode_fast(&running_status, g_bench_messages[j].data, g_bench_messages[j].size, events + j) != g_bench_messages[j].size)
+    {
+      fprintf(stderr, "message %u not encoded by the fast path\n", j);
+      goto free_codec;
+    }
+  }
+  nsecs = (double)(a2j_bench_nsecs() - start) / count;
+  a2j_bench_result("a2j_midi_encode_fast", "ns/event", nsecs, NULL);
+
+  start = a2j_bench_nsecs();
+  for (i = 0; i < count; i++)
+  {
+    j = i % A2J_BENCH_MESSAGES;
+    size = a2j_midi_decode_fast(events + j, data, sizeof(data));
+    if (size != g_bench_messages[j].size)
+    {
+      fprintf(stderr, "message %u decoded to %ld bytes by the fast path\n", j, size);
+      goto free_codec;
+    }
+  }
+  nsecs = (double)(a2j_bench_nsecs() - start) / count;
+  a2j_bench_result("a2j_midi_decode_fast", "ns/event", nsecs, NULL);
+
+  a2j_bench_end();
+
+  snd_midi_event_free(codec);
+  return 0;
+
+free_codec:
+  snd_midi_event_free(codec);
+  return 1;
+}
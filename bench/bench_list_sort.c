@@ -0,0 +1,199 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * ALSA SEQ < - > JACK MIDI bridge
+ *
+ * Copyright (c) 2026 The a2jmidid authors
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ */
+
+/* __list_sort() on lists of 16, 256 and 2048 entries, in random order
+ * and already sorted.
+ *
+ * bench_list_sort [elements_sorted] */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "list.h"
+#include "bench.h"
+
+struct a2j_bench_entry
+{
+  struct list_head siblings;
+  uint32_t key;
+};
+
+static const unsigned int g_bench_counts[] = {16, 256, 2048};
+
+static
+int
+a2j_bench_compare(
+  struct a2j_bench_entry * entry1_ptr,
+  struct a2j_bench_entry * entry2_ptr)
+{
+  return entry1_ptr->key < entry2_ptr->key ? -1 : entry1_ptr->key > entry2_ptr->key;
+}
+
+/* link the entries in array order, the sort reorders the list only */
+static
+void
+a2j_bench_link(
+  struct list_head * list_ptr,
+  struct a2j_bench_entry ** order,
+  unsigned int count)
+{
+  unsigned int i;
+
+  INIT_LIST_HEAD(list_ptr);
+  for (i = 0; i < count; i++)
+  {
+    list_add_tail(&order[i]->siblings, list_ptr);
+  }
+}
+
+static
+bool
+a2j_bench_sorted(
+  struct list_head * list_ptr)
+{
+  struct list_head * node_ptr;
+  uint32_t key;
+
+  key = 0;
+  list_for_each(node_ptr, list_ptr)
+  {
+    if (list_entry(node_ptr, struct a2j_bench_entry, siblings)->key < key)
+    {
+      return false;
+    }
+    key = list_entry(node_ptr, struct a2j_bench_entry, siblings)->key;
+  }
+
+  return true;
+}
+
+static
+bool
+a2j_bench_sort(
+  struct a2j_bench_entry ** order,
+  unsigned int count,
+  unsigned long rounds,
+  double * nsecs_ptr)
+{
+  struct list_head list;
+  unsigned long round;
+  uint64_t nsecs;
+  uint64_t start;
+
+  nsecs = 0;
+  for (round = 0; round < rounds; round++)
+  {
+    a2j_bench_link(&list, order, count);
+
+    start = a2j_bench_nsecs();
+    list_sort(&list, struct a2j_bench_entry, siblings, a2j_bench_compare);
+    nsecs += a2j_bench_nsecs() - start;
+  }
+
+  *nsecs_ptr = (double)nsecs / rounds / count;
+  return a2j_bench_sorted(&list);
+}
+
+static
+int
+a2j_bench_order_compare(
+  const void * a,
+  const void * b)
+{
+  return a2j_bench_compare(*(struct a2j_bench_entry * const *)a, *(struct a2j_bench_entry * const *)b);
+}
+
+static
+bool
+a2j_bench_count(
+  unsigned int count,
+  unsigned long elements)
+{
+  struct a2j_bench_entry * entries;
+  struct a2j_bench_entry ** order;
+  unsigned long rounds;
+  unsigned int i;
+  double nsecs;
+  bool ret;
+
+  ret = false;
+  rounds = elements / count;
+
+  entries = malloc(count * sizeof(struct a2j_bench_entry));
+  order = malloc(count * sizeof(struct a2j_bench_entry *));
+  if (entries == NULL || order == NULL)
+  {
+    goto free_arrays;
+  }
+
+  for (i = 0; i < count; i++)
+  {
+    entries[i].key = a2j_bench_random();
+    order[i] = entries + i;
+  }
+
+  if (!a2j_bench_sort(order, count, rounds, &nsecs))
+  {
+    fprintf(stderr, "list of %u entries not sorted\n", count);
+    goto free_arrays;
+  }
+  a2j_bench_result("__list_sort random", "ns/element", nsecs, "\"elements\": %u", count);
+
+  qsort(order, count, sizeof(order[0]), a2j_bench_order_compare);
+  if (!a2j_bench_sort(order, count, rounds, &nsecs))
+  {
+    fprintf(stderr, "list of %u entries not sorted\n", count);
+    goto free_arrays;
+  }
+  a2j_bench_result("__list_sort sorted", "ns/element", nsecs, "\"elements\": %u", count);
+
+  ret = true;
+
+free_arrays:
+  free(entries);
+  free(order);
+  return ret;
+}
+
+int
+main(
+  int argc,
+  char ** argv)
+{
+  unsigned long elements;
+  unsigned int i;
+
+  elements = a2j_bench_arg(argc, argv, 1, 10000000);
+
+  a2j_bench_begin("list_sort");
+  for (i = 0; i < sizeof(g_bench_counts) / sizeof(g_bench_counts[0]); i++)
+  {
+    if (!a2j_bench_count(g_bench_counts[i], elements))
+    {
+      return 1;
+    }
+  }
+  a2j_bench_end();
+
+  return 0;
+}
@@ -0,0 +1,153 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * ALSA SEQ < - > JACK MIDI bridge
+ *
+ * Copyright (c) 2026 The a2jmidid authors
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ */
+
+/* a2j_process_outgoing() packing the events of a JACK playback port
+ * into its ringbuffer, for short messages and SysEx. The output thread
+ * does not run, the ringbuffer is emptied after each cycle.
+ *
+ * bench_outgoing [cycles] */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <alsa/asoundlib.h>
+#include <jack/jack.h>
+#include <jack/midiport.h>
+#include <jack/ringbuffer.h>
+
+#include "list.h"
+#include "structs.h"
+#include "jack.h"
+#include "mock.h"
+#include "bench.h"
+
+#define A2J_BENCH_NFRAMES 256
+
+struct a2j_bench_case
+{
+  const char * name;
+  unsigned int events;          /* per cycle */
+  size_t size;
+};
+
+static const struct a2j_bench_case g_bench_cases[] =
+{
+  {"a2j_process_outgoing short", 256, 3},
+  {"a2j_process_outgoing sysex", 64, 256},
+};
+
+static
+bool
+a2j_bench_case(
+  struct a2j * self,
+  struct a2j_port * port,
+  const struct a2j_bench_case * case_ptr,
+  unsigned long cycles)
+{
+  jack_midi_data_t data[256];
+  jack_nframes_t first;
+  unsigned long cycle;
+  unsigned long queued;
+  unsigned int i;
+  uint64_t start;
+  uint64_t nsecs;
+
+  memset(data, 0x7F, case_ptr->size);
+  data[0] = case_ptr->size > 3 ? 0xF0 : 0x90;
+  data[case_ptr->size - 1] = case_ptr->size > 3 ? 0xF7 : 0x40;
+
+  nsecs = 0;
+  queued = 0;
+
+  for (cycle = 0; cycle < cycles; cycle++)
+  {
+    for (i = 0; i < case_ptr->events; i++)
+    {
+      a2j_mock_jack_midi_add(port->jack_port, i * A2J_BENCH_NFRAMES / case_ptr->events, data, case_ptr->size);
+    }
+
+    port->jack_buf = self->backend.jack->port_get_buffer(port->jack_port, A2J_BENCH_NFRAMES);
+
+    start = a2j_bench_nsecs();
+    queued += a2j_process_outgoing(self, port, &first);
+    nsecs += a2j_bench_nsecs() - start;
+
+    self->backend.jack->midi_clear_buffer(port->jack_buf);
+    jack_ringbuffer_read_advance(port->outbound_events, jack_ringbuffer_read_space(port->outbound_events));
+  }
+
+  if (queued != cycles * case_ptr->events)
+  {
+    fprintf(stderr, "%lu of %lu events queued\n", queued, cycles * case_ptr->events);
+    return false;
+  }
+
+  a2j_bench_result(
+    case_ptr->name,
+    "ns/event",
+    (double)nsecs / queued,
+    "\"events_per_cycle\": %u, \"event_size\": %zu",
+    case_ptr->events,
+    case_ptr->size);
+  return true;
+}
+
+int
+main(
+  int argc,
+  char ** argv)
+{
+  struct a2j * self;
+  struct a2j_port * port;
+  unsigned long cycles;
+  unsigned int i;
+  int ret;
+
+  cycles = a2j_bench_arg(argc, argv, 1, 100000);
+
+  self = a2j_mock_bridge_new(A2J_BENCH_NFRAMES, A2J_MOCK_SAMPLE_RATE, 1, false);
+  if (self == NULL)
+  {
+    fprintf(stderr, "cannot start the bridge\n");
+    return 1;
+  }
+
+  port = a2j_mock_bridge_port(self, A2J_PORT_PLAYBACK, 0);
+
+  ret = 1;
+
+  a2j_bench_begin("outgoing");
+  for (i = 0; i < sizeof(g_bench_cases) / sizeof(g_bench_cases[0]); i++)
+  {
+    if (!a2j_bench_case(self, port, g_bench_cases + i, cycles))
+    {
+      goto free_bridge;
+    }
+  }
+  a2j_bench_end();
+
+  ret = 0;
+
+free_bridge:
+  a2j_mock_bridge_free(self);
+  return ret;
+}
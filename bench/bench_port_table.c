@@ -0,0 +1,252 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * ALSA SEQ < - > JACK MIDI bridge
+ *
+ * Copyright (c) 2026 The a2jmidid authors
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ */
+
+/* a2j_port_get() on tables of 16, 256 and 2048 ports, addresses in
+ * random order, against the 16 bucket hash it replaced. Misses are
+ * addresses of clients and ports that were not inserted, what the
+ * input thread sees for unbridged ports.
+ *
+ * bench_port_table [lookups] */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <alsa/asoundlib.h>
+#include <jack/jack.h>
+#include <jack/ringbuffer.h>
+
+#include "list.h"
+#include "structs.h"
+#include "port_table.h"
+#include "bench.h"
+
+#define A2J_BENCH_ADDRS        4096     /* power of two */
+#define A2J_BENCH_CLIENT_PORTS 16       /* ports per client, the first client is 16 like the first card */
+
+#define A2J_BENCH_HASH_SIZE    16
+
+static const unsigned int g_bench_ports[] = {16, 256, 2048};
+
+/* the hash before the table, chained through the ports themselves */
+struct a2j_bench_hash_port
+{
+  struct a2j_bench_hash_port * next;
+  struct a2j_port port;
+};
+
+typedef struct a2j_bench_hash_port * a2j_bench_hash_t[A2J_BENCH_HASH_SIZE];
+
+static
+inline
+int
+a2j_bench_hash(
+  snd_seq_addr_t addr)
+{
+  return (addr.client + addr.port) % A2J_BENCH_HASH_SIZE;
+}
+
+static
+struct a2j_port *
+a2j_bench_hash_get(
+  a2j_bench_hash_t hash,
+  snd_seq_addr_t addr)
+{
+  struct a2j_bench_hash_port * hash_port;
+
+  for (hash_port = hash[a2j_bench_hash(addr)]; hash_port != NULL; hash_port = hash_port->next)
+  {
+    if (hash_port->port.remote.client == addr.client && hash_port->port.remote.port == addr.port)
+    {
+      return &hash_port->port;
+    }
+  }
+
+  return NULL;
+}
+
+static
+double
+a2j_bench_hash_lookups(
+  a2j_bench_hash_t hash,
+  const snd_seq_addr_t * addrs,
+  unsigned long lookups,
+  unsigned long * found_ptr)
+{
+  unsigned long i;
+  unsigned long found;
+  uint64_t start;
+
+  found = 0;
+  start = a2j_bench_nsecs();
+  for (i = 0; i < lookups; i++)
+  {
+    if (a2j_bench_hash_get(hash, addrs[i & (A2J_BENCH_ADDRS - 1)]) != NULL)
+    {
+      found++;
+    }
+  }
+
+  *found_ptr = found;
+  return (double)(a2j_bench_nsecs() - start) / lookups;
+}
+
+static
+double
+a2j_bench_lookups(
+  a2j_port_table_t table,
+  const snd_seq_addr_t * addrs,
+  unsigned long lookups,
+  unsigned long * found_ptr)
+{
+  unsigned long i;
+  unsigned long found;
+  uint64_t start;
+
+  found = 0;
+  start = a2j_bench_nsecs();
+  for (i = 0; i < lookups; i++)
+  {
+    if (a2j_port_get(table, addrs[i & (A2J_BENCH_ADDRS - 1)]) != NULL)
+    {
+      found++;
+    }
+  }
+
+  *found_ptr = found;
+  return (double)(a2j_bench_nsecs() - start) / lookups;
+}
+
+static
+bool
+a2j_bench_table(
+  unsigned int count,
+  unsigned long lookups)
+{
+  a2j_port_table_t table;
+  a2j_bench_hash_t hash;
+  struct a2j_bench_hash_port * ports;
+  snd_seq_addr_t * hits;
+  snd_seq_addr_t * misses;
+  unsigned long found;
+  unsigned int i;
+  double nsecs;
+  bool ret;
+
+  ret = false;
+  memset(table, 0, sizeof(table));
+  memset(hash, 0, sizeof(hash));
+
+  ports = calloc(count, sizeof(struct a2j_bench_hash_port));
+  hits = malloc(A2J_BENCH_ADDRS * sizeof(snd_seq_addr_t));
+  misses = malloc(A2J_BENCH_ADDRS * sizeof(snd_seq_addr_t));
+  if (ports == NULL || hits == NULL || misses == NULL)
+  {
+    goto free_arrays;
+  }
+
+  for (i = 0; i < count; i++)
+  {
+    ports[i].port.remote.client = 16 + i / A2J_BENCH_CLIENT_PORTS;
+    ports[i].port.remote.port = i % A2J_BENCH_CLIENT_PORTS;
+    if (!a2j_port_insert(table, &ports[i].port))
+    {
+      goto free_table;
+    }
+
+    ports[i].next = hash[a2j_bench_hash(ports[i].port.remote)];
+    hash[a2j_bench_hash(ports[i].port.remote)] = ports + i;
+  }
+
+  for (i = 0; i < A2J_BENCH_ADDRS; i++)
+  {
+    hits[i] = ports[a2j_bench_random() % count].port.remote;
+
+    /* half on clients with bridged ports, half on clients without */
+    misses[i].client = i % 2 ? hits[i].client : 16 + (count + A2J_BENCH_CLIENT_PORTS - 1) / A2J_BENCH_CLIENT_PORTS + a2j_bench_random() % 64;
+    misses[i].port = A2J_BENCH_CLIENT_PORTS + a2j_bench_random() % 64;
+  }
+
+  nsecs = a2j_bench_lookups(table, hits, lookups, &found);
+  if (found != lookups)
+  {
+    fprintf(stderr, "%lu of %lu ports not found\n", lookups - found, lookups);
+    goto free_table;
+  }
+  a2j_bench_result("a2j_port_get hit", "ns/lookup", nsecs, "\"ports\": %u", count);
+
+  nsecs = a2j_bench_lookups(table, misses, lookups, &found);
+  if (found != 0)
+  {
+    fprintf(stderr, "%lu of %lu missing ports found\n", found, lookups);
+    goto free_table;
+  }
+  a2j_bench_result("a2j_port_get miss", "ns/lookup", nsecs, "\"ports\": %u", count);
+
+  nsecs = a2j_bench_hash_lookups(hash, hits, lookups, &found);
+  if (found != lookups)
+  {
+    fprintf(stderr, "%lu of %lu ports not found in the hash\n", lookups - found, lookups);
+    goto free_table;
+  }
+  a2j_bench_result("hash hit", "ns/lookup", nsecs, "\"ports\": %u", count);
+
+  nsecs = a2j_bench_hash_lookups(hash, misses, lookups, &found);
+  if (found != 0)
+  {
+    fprintf(stderr, "%lu of %lu missing ports found in the hash\n", found, lookups);
+    goto free_table;
+  }
+  a2j_bench_result("hash miss", "ns/lookup", nsecs, "\"ports\": %u", count);
+
+  ret = true;
+
+free_table:
+  a2j_port_table_free(table);
+free_arrays:
+  free(ports);
+  free(hits);
+  free(misses);
+  return ret;
+}
+
+int
+main(
+  int argc,
+  char ** argv)
+{
+  unsigned long lookups;
+  unsigned int i;
+
+  lookups = a2j_bench_arg(argc, argv, 1, 10000000);
+
+  a2j_bench_begin("port_table");
+  for (i = 0; i < sizeof(g_bench_ports) / sizeof(g_bench_ports[0]); i++)
+  {
+    if (!a2j_bench_table(g_bench_ports[i], lookups))
+    {
+      return 1;
+    }
+  }
+  a2j_bench_end();
+
+  return 0;
+}
@@ -0,0 +1,222 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * ALSA SEQ < - > JACK MIDI bridge
+ *
+ * Copyright (c) 2026 The a2jmidid authors
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ */
+
+/* The capture port ringbuffer: a2j_input_event() writes the header and
+ * data of each event through the write vector and a2j_process_incoming()
+ * copies them out through the read vector. Messages of one to three
+ * bytes move the events across the end of the ringbuffer at every
+ * offset, so split copies are included. The read is compared with how
+ * a2j_process_incoming() read events before, peeking the header, then
+ * header and data into an alloca() buffer, once per event.
+ *
+ * bench_ring [events] */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <alloca.h>
+#include <alsa/asoundlib.h>
+#include <jack/jack.h>
+#include <jack/midiport.h>
+#include <jack/ringbuffer.h>
+
+#include "list.h"
+#include "structs.h"
+#include "ringbuffer_vector.h"
+#include "bench.h"
+
+#define A2J_BENCH_CYCLE_EVENTS 64       /* written before they are read */
+
+static const jack_midi_data_t g_bench_data[3] = {0x90, 60, 100};
+
+/* as a2j_input_event() queues an event */
+static
+bool
+a2j_bench_write(
+  jack_ringbuffer_t * ring,
+  int64_t time,
+  const jack_midi_data_t * data,
+  int size)
+{
+  struct a2j_alsa_midi_event ev;
+  jack_ringbuffer_data_t vec[2];
+
+  if (jack_ringbuffer_write_space(ring) < sizeof(ev) + size)
+  {
+    return false;
+  }
+
+  ev.time = time;
+  ev.size = size;
+  ev.sysex = NULL;
+
+  jack_ringbuffer_get_write_vector(ring, vec);
+  a2j_write_vector_copy(vec, &ev, sizeof(ev));
+  a2j_write_vector_copy(vec, data, size);
+  jack_ringbuffer_write_advance(ring, sizeof(ev) + size);
+  return true;
+}
+
+/* as a2j_process_incoming() takes the events of a cycle, returns events read */
+static
+unsigned int
+a2j_bench_read(
+  jack_ringbuffer_t * ring,
+  jack_midi_data_t * buf)
+{
+  struct a2j_alsa_midi_event ev;
+  jack_ringbuffer_data_t vec[2];
+  size_t consumed;
+  unsigned int count;
+
+  jack_ringbuffer_get_read_vector(ring, vec);
+  consumed = 0;
+  count = 0;
+
+  while (vec[0].len + vec[1].len >= sizeof(ev))
+  {
+    a2j_read_vector_copy(vec, &ev, sizeof(ev));
+    a2j_read_vector_copy(vec, buf, ev.size);
+    consumed += sizeof(ev) + ev.size;
+    count++;
+  }
+
+  jack_ringbuffer_read_advance(ring, consumed);
+  return count;
+}
+
+/* the read before the vectors, returns events read */
+static
+unsigned int
+a2j_bench_read_peek(
+  jack_ringbuffer_t * ring,
+  jack_midi_data_t * buf)
+{
+  struct a2j_alsa_midi_event ev;
+  char * ev_buf;
+  unsigned int count;
+
+  count = 0;
+
+  while (jack_ringbuffer_peek(ring, (char *)&ev, sizeof(ev)) == sizeof(ev))
+  {
+    ev_buf = (char *)alloca(sizeof(ev) + ev.size);
+
+    if (jack_ringbuffer_peek(ring, ev_buf, sizeof(ev) + ev.size) != sizeof(ev) + ev.size)
+    {
+      break;
+    }
+
+    memcpy(buf, ev_buf + sizeof(ev), ev.size);
+    jack_ringbuffer_read_advance(ring, sizeof(ev) + ev.size);
+    count++;
+  }
+
+  return count;
+}
+
+static
+bool
+a2j_bench_ring(
+  jack_ringbuffer_t * ring,
+  unsigned int (* read)(jack_ringbuffer_t * ring, jack_midi_data_t * buf),
+  unsigned long count,
+  double * write_nsecs_ptr,
+  double * read_nsecs_ptr)
+{
+  jack_midi_data_t buf[MAX_EVENT_SIZE];
+  unsigned long i;
+  unsigned long events;
+  unsigned int j;
+  uint64_t start;
+  uint64_t write_nsecs;
+  uint64_t read_nsecs;
+
+  write_nsecs = 0;
+  read_nsecs = 0;
+  events = 0;
+
+  for (i = 0; i < count; i += A2J_BENCH_CYCLE_EVENTS)
+  {
+    start = a2j_bench_nsecs();
+    for (j = 0; j < A2J_BENCH_CYCLE_EVENTS; j++)
+    {
+      a2j_bench_write(ring, i + j, g_bench_data, 1 + (i + j) % 3);
+    }
+    write_nsecs += a2j_bench_nsecs() - start;
+
+    start = a2j_bench_nsecs();
+    events += read(ring, buf);
+    read_nsecs += a2j_bench_nsecs() - start;
+  }
+
+  if (events != i)
+  {
+    fprintf(stderr, "%lu of %lu events read\n", events, i);
+    return false;
+  }
+
+  *write_nsecs_ptr = (double)write_nsecs / events;
+  *read_nsecs_ptr = (double)read_nsecs / events;
+  return true;
+}
+
+int
+main(
+  int argc,
+  char ** argv)
+{
+  jack_ringbuffer_t * ring;
+  unsigned long count;
+  double write_nsecs;
+  double read_nsecs;
+  double peek_nsecs;
+  int ret;
+
+  count = a2j_bench_arg(argc, argv, 1, 10000000);
+
+  ring = jack_ringbuffer_create(MAX_EVENT_SIZE * 16);
+  if (ring == NULL)
+  {
+    return 1;
+  }
+
+  ret = 1;
+
+  if (!a2j_bench_ring(ring, a2j_bench_read_peek, count, &write_nsecs, &peek_nsecs) ||
+      !a2j_bench_ring(ring, a2j_bench_read, count, &write_nsecs, &read_nsecs))
+  {
+    goto free_ring;
+  }
+
+  a2j_bench_begin("ring");
+  a2j_bench_result("input ring write", "ns/event", write_nsecs, NULL);
+  a2j_bench_result("incoming ring read", "ns/event", read_nsecs, NULL);
+  a2j_bench_result("incoming ring read peek", "ns/event", peek_nsecs, NULL);
+  a2j_bench_end();
+
+  ret = 0;
+
+free_ring:
+  jack_ringbuffer_free(ring);
+  return ret;
+}
@@ -0,0 +1,166 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * ALSA SEQ < - > JACK MIDI bridge
+ *
+ * Copyright (c) 2026 The a2jmidid authors
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ */
+
+/* Bulk SysEx through the bridge, one JACK event per cycle on one
+ * playback port, until the output thread has handed all its bytes to the
+ * sequencer. Events up to the -m limit of a2jmidid are forwarded, larger
+ * ones are dropped by a2j_process_outgoing().
+ *
+ * bench_sysex [event_size] [events] [nframes] */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <alsa/asoundlib.h>
+#include <jack/jack.h>
+#include <jack/midiport.h>
+#include <jack/ringbuffer.h>
+
+#include "list.h"
+#include "structs.h"
+#include "port_thread.h"
+#include "conf.h"
+#include "mock.h"
+#include "bench.h"
+
+#define A2J_BENCH_OUTPUT_NSECS 1000000000  /* how long to wait for the output thread */
+
+int
+main(
+  int argc,
+  char ** argv)
+{
+  struct a2j * self;
+  struct a2j_port * port;
+  struct a2j_mock_seq_stats before;
+  struct a2j_mock_seq_stats after;
+  jack_midi_data_t * data;
+  size_t size;
+  unsigned long events;
+  jack_nframes_t nframes;
+  unsigned long i;
+  uint64_t start;
+  uint64_t deadline;
+  uint64_t bytes;
+  uint64_t nsecs;
+  int ret;
+
+  size = a2j_bench_arg(argc, argv, 1, A2J_DEFAULT_MAX_OUTBOUND_EVENT_SIZE);
+  events = a2j_bench_arg(argc, argv, 2, 1000);
+  nframes = a2j_bench_arg(argc, argv, 3, 256);
+
+  if (size < 2 || size > A2J_MOCK_MIDI_BUFFER_SIZE)
+  {
+    fprintf(stderr, "event size must be between 2 and %u\n", A2J_MOCK_MIDI_BUFFER_SIZE);
+    return 1;
+  }
+
+  ret = 1;
+
+  data = malloc(size);
+  if (data == NULL)
+  {
+    return 1;
+  }
+
+  memset(data, 0x7F, size);
+  data[0] = 0xF0;
+  data[size - 1] = 0xF7;
+
+  g_a2j_max_event_size = size;
+
+  self = a2j_mock_bridge_new(nframes, A2J_MOCK_SAMPLE_RATE, 1, true);
+  if (self == NULL)
+  {
+    fprintf(stderr, "cannot start the bridge\n");
+    goto free_data;
+  }
+
+  port = a2j_mock_bridge_port(self, A2J_PORT_PLAYBACK, 0);
+  if (port == NULL)
+  {
+    fprintf(stderr, "client port 0 is not bridged\n");
+    goto free_bridge;
+  }
+
+  a2j_mock_seq_stats(self->seq, &before);
+
+  start = a2j_bench_nsecs();
+  for (i = 0; i < events; i++)
+  {
+    if (!a2j_mock_jack_midi_add(port->jack_port, 0, data, size))
+    {
+      fprintf(stderr, "cannot queue a %zu bytes JACK event\n", size);
+      goto free_bridge;
+    }
+
+    a2j_mock_jack_cycle();
+
+    /* the ringbuffer holds one such event, the next cycle waits for it */
+    deadline = a2j_bench_nsecs() + A2J_BENCH_OUTPUT_NSECS;
+    do
+    {
+      a2j_mock_seq_stats(self->seq, &after);
+      if (after.output_bytes - before.output_bytes >= (i + 1) * size)
+      {
+        break;
+      }
+      sched_yield();
+    } while (a2j_bench_nsecs() < deadline);
+  }
+  nsecs = a2j_bench_nsecs() - start;
+
+  bytes = after.output_bytes - before.output_bytes;
+
+  a2j_bench_begin("sysex");
+  a2j_bench_result(
+    "sysex throughput",
+    "MB/s",
+    nsecs ? bytes * 1000.0 / nsecs : 0,
+    "\"event_size\": %zu, \"nframes\": %u",
+    size,
+    (unsigned int)nframes);
+  a2j_bench_result(
+    "sysex events per write",
+    "events/write",
+    after.writes > before.writes ? (double)(after.output_events - before.output_events) / (after.writes - before.writes) : 0,
+    "\"event_size\": %zu, \"nframes\": %u",
+    size,
+    (unsigned int)nframes);
+  a2j_bench_result(
+    "sysex lost",
+    "bytes",
+    (double)((uint64_t)events * size - bytes),
+    "\"event_size\": %zu, \"nframes\": %u",
+    size,
+    (unsigned int)nframes);
+  a2j_bench_end();
+
+  ret = 0;
+
+free_bridge:
+  a2j_mock_bridge_free(self);
+free_data:
+  free(data);
+  return ret;
+}
@@ -0,0 +1,154 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * ALSA SEQ < - > JACK MIDI bridge
+ *
+ * Copyright (c) 2026 The a2jmidid authors
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ */
+
+#ifndef MOCK_H__CD7CB857_CBFD_4953_8471_1630E44D4DDD__INCLUDED
+#define MOCK_H__CD7CB857_CBFD_4953_8471_1630E44D4DDD__INCLUDED
+
+/* In-process stand-ins for the JACK server and the ALSA sequencer,
+ * behind the same struct a2j_backend the bridge calls libjack and
+ * alsa-lib through. The ringbuffer and the MIDI event codec stay the
+ * real ones. a2jmidid itself never links them. */
+
+/* JACK */
+
+extern const struct a2j_jack_ops g_a2j_mock_jack_ops;
+
+#define A2J_MOCK_MIDI_BUFFER_EVENTS 4096
+#define A2J_MOCK_MIDI_BUFFER_SIZE   (256 * 1024)
+
+void
+a2j_mock_jack_init(
+  jack_nframes_t nframes,
+  jack_nframes_t sample_rate);
+
+/* run one process cycle right away, the period starts now */
+void
+a2j_mock_jack_cycle(void);
+
+/* queue an event in the buffer of a JACK input port for the next cycle */
+bool
+a2j_mock_jack_midi_add(
+  jack_port_t * port,
+  jack_nframes_t time,
+  const jack_midi_data_t * data,
+  size_t size);
+
+/* events written to a JACK output port in the last cycle */
+uint32_t
+a2j_mock_jack_midi_count(
+  jack_port_t * port);
+
+/* sequencer */
+
+extern const struct a2j_seq_ops g_a2j_mock_seq_ops;
+
+struct a2j_mock_seq_stats
+{
+  uint64_t input_events;        /* dispatched by the input thread */
+  uint64_t output_events;       /* passed to event_output() */
+  uint64_t output_bytes;        /* of variable length output events */
+  uint64_t drains;              /* drain_output() calls */
+  uint64_t writes;              /* write() calls a real sequencer would make */
+};
+
+snd_seq_t *
+a2j_mock_seq_open(void);
+
+void
+a2j_mock_seq_close(
+  snd_seq_t * seq);
+
+/* snd_seq_set_output_buffer_size() */
+int
+a2j_mock_seq_set_output_buffer_size(
+  snd_seq_t * seq,
+  size_t size);
+
+/* a client port for a2j_input_scan_ports() and get_any_port_info() */
+bool
+a2j_mock_seq_add_port(
+  snd_seq_t * seq,
+  int client,
+  int port,
+  const char * name,
+  unsigned int caps,
+  unsigned int type);
+
+/* queue events for the ALSA input thread and wake it, returns how many fit */
+size_t
+a2j_mock_seq_inject(
+  snd_seq_t * seq,
+  const snd_seq_event_t * events,
+  size_t count);
+
+/* injected events the input thread did not dispatch yet */
+size_t
+a2j_mock_seq_pending(
+  snd_seq_t * seq);
+
+void
+a2j_mock_seq_stats(
+  snd_seq_t * seq,
+  struct a2j_mock_seq_stats * stats_ptr);
+
+/* bridge */
+
+#define A2J_MOCK_SAMPLE_RATE  48000
+#define A2J_MOCK_CLIENT_ID    128       /* the bridge */
+#define A2J_MOCK_FIRST_CLIENT 129       /* the client ports */
+#define A2J_MOCK_CLIENT_PORTS 64        /* client ports per client */
+
+struct a2j;
+struct a2j_port;
+
+/* g_a2j_mock_jack_ops and g_a2j_mock_seq_ops */
+extern const struct a2j_backend g_a2j_backend_mock;
+
+/* a2j_new() on the mocks with ports duplex client ports, each bridged both
+   ways. without threads the ALSA threads are not started, for benchmarks
+   that call into the process paths themselves */
+struct a2j *
+a2j_mock_bridge_new(
+  jack_nframes_t nframes,
+  jack_nframes_t sample_rate,
+  unsigned int ports,
+  bool threads);
+
+void
+a2j_mock_bridge_free(
+  struct a2j * self);
+
+/* what the a2jmidid main loop does on each pass */
+void
+a2j_mock_bridge_idle(
+  struct a2j * self);
+
+snd_seq_addr_t
+a2j_mock_bridge_addr(
+  unsigned int index);
+
+/* the bridge port of client port index */
+struct a2j_port *
+a2j_mock_bridge_port(
+  struct a2j * self,
+  int dir,
+  unsigned int index);
+
+#endif /* #ifndef MOCK_H__CD7CB857_CBFD_4953_8471_1630E44D4DDD__INCLUDED */
@@ -0,0 +1,377 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * ALSA SEQ < - > JACK MIDI bridge
+ *
+ * Copyright (c) 2026 The a2jmidid authors
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ */
+
+/* The bridge set up like a2j_new() does, on the mock JACK server and
+ * sequencer, and the globals a2jmidid.c defines for the bridge code. */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <alsa/asoundlib.h>
+#include <jack/jack.h>
+#include <jack/midiport.h>
+#include <jack/ringbuffer.h>
+
+#include "list.h"
+#include "structs.h"
+#include "port.h"
+#include "port_thread.h"
+#include "port_table.h"
+#include "log.h"
+#include "a2jmidid.h"
+#include "conf.h"
+#include "jack.h"
+#include "mock.h"
+
+bool g_keep_walking = true;
+bool g_keep_alsa_walking = false;
+bool g_stop_request = false;
+size_t g_max_jack_port_name_size = 256;
+bool g_disable_port_uniqueness = false;
+
+bool g_a2j_export_hw_ports = false;
+bool g_a2j_kernel_scheduling = false;
+size_t g_a2j_output_buffer_size = 0;
+unsigned int g_a2j_spin_usecs = 0;
+size_t g_a2j_max_event_size = A2J_DEFAULT_MAX_OUTBOUND_EVENT_SIZE;
+bool g_a2j_lock_memory = false;
+bool g_a2j_raw_input = false;
+unsigned int g_a2j_input_delay = 0;
+bool g_a2j_input_delay_adaptive = false;
+unsigned int g_a2j_output_delay = 0;
+bool g_a2j_output_delay_period = false;
+char * g_a2j_jack_server_name = NULL;
+char * g_a2j_trace_path = NULL;
+
+const struct a2j_backend g_a2j_backend_mock =
+{
+  .jack = &g_a2j_mock_jack_ops,
+  .seq = &g_a2j_mock_seq_ops,
+};
+
+snd_seq_addr_t
+a2j_mock_bridge_addr(
+  unsigned int index)
+{
+  snd_seq_addr_t addr;
+
+  addr.client = A2J_MOCK_FIRST_CLIENT + index / A2J_MOCK_CLIENT_PORTS;
+  addr.port = index % A2J_MOCK_CLIENT_PORTS;
+  return addr;
+}
+
+struct a2j_port *
+a2j_mock_bridge_port(
+  struct a2j * self,
+  int dir,
+  unsigned int index)
+{
+  return a2j_find_port_by_addr(self->stream + dir, a2j_mock_bridge_addr(index));
+}
+
+/* an announce the bridge ignores, it wakes the input thread like the subscription a2j_new() makes */
+static
+void
+a2j_mock_bridge_announce(
+  struct a2j * self)
+{
+  snd_seq_event_t event;
+
+  snd_seq_ev_clear(&event);
+  event.type = SND_SEQ_EVENT_PORT_START;
+  event.source.client = SND_SEQ_CLIENT_SYSTEM;
+  event.source.port = SND_SEQ_PORT_SYSTEM_ANNOUNCE;
+  event.data.addr.client = self->client_id;
+  event.data.addr.port = self->port_id;
+  a2j_mock_seq_inject(self->seq, &event, 1);
+}
+
+static
+bool
+a2j_mock_bridge_stream_init(
+  struct a2j * self,
+  int dir)
+{
+  INIT_LIST_HEAD(&self->stream[dir].list);
+  return a2j_port_slab_init(self->stream + dir, dir);
+}
+
+static
+void
+a2j_mock_bridge_stream_close(
+  struct a2j * self,
+  int dir)
+{
+  struct a2j_stream * stream_ptr = self->stream + dir;
+  struct list_head * node_ptr;
+
+  a2j_free_port_arrays(stream_ptr);
+
+  while (!list_empty(&stream_ptr->list))
+  {
+    node_ptr = stream_ptr->list.next;
+    list_del(node_ptr);
+    a2j_port_free(list_entry(node_ptr, struct a2j_port, siblings));
+  }
+
+  a2j_port_table_free(stream_ptr->port_table);
+  a2j_slab_uninit(&stream_ptr->port_slab);
+}
+
+struct a2j *
+a2j_mock_bridge_new(
+  jack_nframes_t nframes,
+  jack_nframes_t sample_rate,
+  unsigned int ports,
+  bool threads)
+{
+  struct a2j * self;
+  snd_seq_addr_t addr;
+  char name[64];
+  unsigned int i;
+
+  if (ports > MAX_PORTS)
+  {
+    a2j_error("%u ports, the bridge takes at most %u", ports, MAX_PORTS);
+    goto fail;
+  }
+
+  a2j_mock_jack_init(nframes, sample_rate);
+
+  self = calloc(1, sizeof(struct a2j));
+  if (self == NULL)
+  {
+    goto fail;
+  }
+
+  self->backend = g_a2j_backend_mock;
+
+  INIT_LIST_HEAD(&self->zombie_ports);
+  pthread_mutex_init(&self->ports_lock, NULL);
+  a2j_histogram_reset(&self->output_lateness);
+
+  self->port_add = jack_ringbuffer_create(2 * MAX_PORTS * sizeof(snd_seq_addr_t));
+  if (self->port_add == NULL)
+  {
+    goto free_self;
+  }
+
+  self->port_del = jack_ringbuffer_create(2 * MAX_PORTS * sizeof(struct a2j_port *));
+  if (self->port_del == NULL)
+  {
+    goto free_ringbuffer_add;
+  }
+
+  if (!a2j_sysex_pool_init(&self->sysex_pool, A2J_SYSEX_POOL_SIZE, g_a2j_max_event_size, g_a2j_lock_memory))
+  {
+    goto free_ringbuffer_del;
+  }
+
+  if (!a2j_sysex_pool_init(&self->sysex_out_pool, A2J_SYSEX_POOL_SIZE, g_a2j_max_event_size, g_a2j_lock_memory))
+  {
+    goto free_sysex_pool;
+  }
+
+  if (!a2j_mock_bridge_stream_init(self, A2J_PORT_CAPTURE))
+  {
+    goto free_sysex_out_pool;
+  }
+
+  if (!a2j_mock_bridge_stream_init(self, A2J_PORT_PLAYBACK))
+  {
+    goto close_capture_stream;
+  }
+
+  self->seq = a2j_mock_seq_open();
+  if (self->seq == NULL)
+  {
+    goto close_playback_stream;
+  }
+
+  if (g_a2j_output_buffer_size != 0)
+  {
+    a2j_mock_seq_set_output_buffer_size(self->seq, g_a2j_output_buffer_size);
+  }
+
+  self->client_id = A2J_MOCK_CLIENT_ID;
+  self->port_id = 0;
+  self->queue = 0;
+
+  for (i = 0; i < ports; i++)
+  {
+    addr = a2j_mock_bridge_addr(i);
+    snprintf(name, sizeof(name), "port %u", i);
+    a2j_mock_seq_add_port(
+      self->seq,
+      addr.client,
+      addr.port,
+      name,
+      SND_SEQ_PORT_CAP_READ | SND_SEQ_PORT_CAP_SUBS_READ | SND_SEQ_PORT_CAP_WRITE | SND_SEQ_PORT_CAP_SUBS_WRITE,
+      SND_SEQ_PORT_TYPE_MIDI_GENERIC | SND_SEQ_PORT_TYPE_APPLICATION);
+  }
+
+  self->jack_client = a2j_jack_client_create(self, A2J_JACK_CLIENT_NAME, NULL);
+  if (self->jack_client == NULL)
+  {
+    goto close_seq;
+  }
+
+  self->out_next_frame = A2J_OUTPUT_IDLE;
+
+  self->io_eventfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (self->io_eventfd < 0)
+  {
+    a2j_error("can't create IO eventfd: %s", strerror(errno));
+    goto close_seq;
+  }
+
+  self->io_timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (self->io_timerfd < 0)
+  {
+    a2j_error("can't create IO timerfd: %s", strerror(errno));
+    goto close_eventfd;
+  }
+
+  /* what the initial scan of the input thread would queue */
+  for (i = 0; i < ports; i++)
+  {
+    addr = a2j_mock_bridge_addr(i);
+    jack_ringbuffer_write(self->port_add, (char *)&addr, sizeof(addr));
+  }
+
+  a2j_update_ports(self);
+
+  /* the process thread picks up the port arrays */
+  a2j_mock_jack_cycle();
+  a2j_reclaim_ports(self);
+
+  if (!threads)
+  {
+    return self;
+  }
+
+  g_keep_alsa_walking = true;
+
+  if (pthread_create(&self->alsa_input_thread, NULL, a2j_alsa_input_thread, self) != 0)
+  {
+    a2j_error("cannot start ALSA input thread");
+    goto close_timerfd;
+  }
+
+  if (pthread_create(&self->alsa_output_thread, NULL, a2j_alsa_output_thread, self) != 0)
+  {
+    a2j_error("cannot start ALSA output thread");
+    goto join_input_thread;
+  }
+
+  /* get the initial scan of the input thread done before anything is measured */
+  a2j_mock_bridge_announce(self);
+  while (a2j_mock_seq_pending(self->seq) != 0)
+  {
+    sched_yield();
+  }
+
+  a2j_mock_bridge_idle(self);
+
+  return self;
+
+join_input_thread:
+  g_keep_alsa_walking = false;
+  a2j_mock_bridge_announce(self);
+  pthread_join(self->alsa_input_thread, NULL);
+close_timerfd:
+  close(self->io_timerfd);
+close_eventfd:
+  close(self->io_eventfd);
+close_seq:
+  a2j_mock_seq_close(self->seq);
+close_playback_stream:
+  a2j_mock_bridge_stream_close(self, A2J_PORT_PLAYBACK);
+close_capture_stream:
+  a2j_mock_bridge_stream_close(self, A2J_PORT_CAPTURE);
+free_sysex_out_pool:
+  a2j_sysex_pool_uninit(&self->sysex_out_pool);
+free_sysex_pool:
+  a2j_sysex_pool_uninit(&self->sysex_pool);
+free_ringbuffer_del:
+  jack_ringbuffer_free(self->port_del);
+free_ringbuffer_add:
+  jack_ringbuffer_free(self->port_add);
+free_self:
+  pthread_mutex_destroy(&self->ports_lock);
+  free(self);
+fail:
+  return NULL;
+}
+
+void
+a2j_mock_bridge_idle(
+  struct a2j * self)
+{
+  a2j_free_ports(self);
+  a2j_update_ports(self);
+  a2j_reclaim_ports(self);
+  a2j_jack_update_latency(self);
+}
+
+void
+a2j_mock_bridge_free(
+  struct a2j * self)
+{
+  struct list_head * node_ptr;
+
+  if (g_keep_alsa_walking)
+  {
+    g_keep_alsa_walking = false;
+    a2j_mock_bridge_announce(self);
+    pthread_join(self->alsa_input_thread, NULL);
+
+    a2j_wake_output_thread(self);
+    pthread_join(self->alsa_output_thread, NULL);
+  }
+
+  close(self->io_timerfd);
+  close(self->io_eventfd);
+
+  while (!list_empty(&self->zombie_ports))
+  {
+    node_ptr = self->zombie_ports.next;
+    list_del(node_ptr);
+    a2j_port_free(list_entry(node_ptr, struct a2j_port, siblings));
+  }
+
+  a2j_mock_bridge_stream_close(self, A2J_PORT_CAPTURE);
+  a2j_mock_bridge_stream_close(self, A2J_PORT_PLAYBACK);
+
+  a2j_mock_seq_close(self->seq);
+  a2j_sysex_pool_uninit(&self->sysex_pool);
+  a2j_sysex_pool_uninit(&self->sysex_out_pool);
+  jack_ringbuffer_free(self->port_add);
+  jack_ringbuffer_free(self->port_del);
+  pthread_mutex_destroy(&self->ports_lock);
+  free(self);
+}
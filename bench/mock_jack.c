@@ -0,0 +1,546 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * ALSA SEQ < - > JACK MIDI bridge
+ *
+ * Copyright (c) 2026 The a2jmidid authors
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ */
+
+/* The JACK server for benchmarks: one client, MIDI port buffers in
+ * memory and process cycles run by the benchmark when it asks for them.
+ * JACK time is the monotonic clock, like in the server; frame time
+ * follows it from the start of the last cycle up to the end of its
+ * period, where the next cycle would have started. */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <alsa/asoundlib.h>
+#include <jack/jack.h>
+#include <jack/midiport.h>
+
+#include "backend.h"
+#include "mock.h"
+
+struct a2j_mock_midi_event
+{
+  jack_nframes_t time;
+  size_t offset;
+  size_t size;
+};
+
+struct a2j_mock_midi_buffer
+{
+  uint32_t count;
+  size_t used;
+  struct a2j_mock_midi_event events[A2J_MOCK_MIDI_BUFFER_EVENTS];
+  jack_midi_data_t data[A2J_MOCK_MIDI_BUFFER_SIZE];
+};
+
+struct _jack_port
+{
+  struct _jack_port * next;
+  unsigned long flags;
+  jack_latency_range_t latency[2];
+  struct a2j_mock_midi_buffer buffer;
+  char name[0];
+};
+
+/* where the current cycle started, read by the ALSA threads under a sequence count */
+struct a2j_mock_cycle
+{
+  unsigned int seq;
+  jack_nframes_t frames;
+  jack_time_t usecs;
+};
+
+struct _jack_client
+{
+  jack_nframes_t nframes;
+  jack_nframes_t sample_rate;
+  struct a2j_mock_cycle cycle;
+  bool started;
+  struct _jack_port * ports;
+
+  JackProcessCallback process;
+  void * process_arg;
+  JackThreadInitCallback thread_init;
+  void * thread_init_arg;
+  JackLatencyCallback latency;
+  void * latency_arg;
+};
+
+static struct _jack_client g_mock_jack_client;
+
+void
+a2j_mock_jack_init(
+  jack_nframes_t nframes,
+  jack_nframes_t sample_rate)
+{
+  memset(&g_mock_jack_client, 0, sizeof(g_mock_jack_client));
+  g_mock_jack_client.nframes = nframes;
+  g_mock_jack_client.sample_rate = sample_rate;
+}
+
+static
+void
+a2j_mock_cycle_read(
+  const jack_client_t * client,
+  jack_nframes_t * frames_ptr,
+  jack_time_t * usecs_ptr)
+{
+  unsigned int seq;
+
+  do
+  {
+    seq = __atomic_load_n(&client->cycle.seq, __ATOMIC_ACQUIRE);
+    *frames_ptr = __atomic_load_n(&client->cycle.frames, __ATOMIC_RELAXED);
+    *usecs_ptr = __atomic_load_n(&client->cycle.usecs, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  } while ((seq & 1) != 0 || seq != __atomic_load_n(&client->cycle.seq, __ATOMIC_RELAXED));
+}
+
+/* struct a2j_jack_ops */
+
+static
+jack_client_t *
+a2j_mock_jack_client_open(
+  const char * client_name,
+  jack_options_t options,
+  jack_status_t * status,
+  const char * server_name)
+{
+  return &g_mock_jack_client;
+}
+
+static
+jack_nframes_t
+a2j_mock_jack_get_buffer_size(
+  jack_client_t * client)
+{
+  return client->nframes;
+}
+
+static
+jack_nframes_t
+a2j_mock_jack_get_sample_rate(
+  jack_client_t * client)
+{
+  return client->sample_rate;
+}
+
+static
+int
+a2j_mock_jack_set_process_callback(
+  jack_client_t * client,
+  JackProcessCallback callback,
+  void * arg)
+{
+  client->process = callback;
+  client->process_arg = arg;
+  return 0;
+}
+
+static
+int
+a2j_mock_jack_set_thread_init_callback(
+  jack_client_t * client,
+  JackThreadInitCallback callback,
+  void * arg)
+{
+  client->thread_init = callback;
+  client->thread_init_arg = arg;
+  return 0;
+}
+
+static
+int
+a2j_mock_jack_set_latency_callback(
+  jack_client_t * client,
+  JackLatencyCallback callback,
+  void * arg)
+{
+  client->latency = callback;
+  client->latency_arg = arg;
+  return 0;
+}
+
+static
+int
+a2j_mock_jack_set_freewheel_callback(
+  jack_client_t * client,
+  JackFreewheelCallback callback,
+  void * arg)
+{
+  return 0;
+}
+
+static
+int
+a2j_mock_jack_set_buffer_size_callback(
+  jack_client_t * client,
+  JackBufferSizeCallback callback,
+  void * arg)
+{
+  return 0;
+}
+
+static
+void
+a2j_mock_jack_on_shutdown(
+  jack_client_t * client,
+  JackShutdownCallback callback,
+  void * arg)
+{
+}
+
+static
+jack_port_t *
+a2j_mock_jack_port_register(
+  jack_client_t * client,
+  const char * port_name,
+  const char * port_type,
+  unsigned long flags,
+  unsigned long buffer_size)
+{
+  jack_port_t * port;
+
+  port = calloc(1, sizeof(struct _jack_port) + strlen(port_name) + 1);
+  if (port == NULL)
+  {
+    return NULL;
+  }
+
+  port->flags = flags;
+  strcpy(port->name, port_name);
+  port->next = client->ports;
+  client->ports = port;
+
+  return port;
+}
+
+static
+int
+a2j_mock_jack_port_unregister(
+  jack_client_t * client,
+  jack_port_t * port)
+{
+  struct _jack_port ** link_ptr;
+
+  for (link_ptr = &client->ports; *link_ptr != NULL; link_ptr = &(*link_ptr)->next)
+  {
+    if (*link_ptr == port)
+    {
+      *link_ptr = port->next;
+      free(port);
+      return 0;
+    }
+  }
+
+  return -1;
+}
+
+static
+void *
+a2j_mock_jack_port_get_buffer(
+  jack_port_t * port,
+  jack_nframes_t nframes)
+{
+  return &port->buffer;
+}
+
+static
+const char *
+a2j_mock_jack_port_name(
+  const jack_port_t * port)
+{
+  return port->name;
+}
+
+static
+void
+a2j_mock_jack_port_set_latency_range(
+  jack_port_t * port,
+  jack_latency_callback_mode_t mode,
+  jack_latency_range_t * range)
+{
+  port->latency[mode == JackCaptureLatency ? 0 : 1] = *range;
+}
+
+static
+int
+a2j_mock_jack_recompute_total_latencies(
+  jack_client_t * client)
+{
+  if (client->latency != NULL)
+  {
+    client->latency(JackCaptureLatency, client->latency_arg);
+    client->latency(JackPlaybackLatency, client->latency_arg);
+  }
+
+  return 0;
+}
+
+static
+jack_time_t
+a2j_mock_jack_get_time(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (jack_time_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static
+jack_nframes_t
+a2j_mock_jack_last_frame_time(
+  const jack_client_t * client)
+{
+  return client->cycle.frames;
+}
+
+static
+jack_nframes_t
+a2j_mock_jack_frame_time(
+  const jack_client_t * client)
+{
+  jack_nframes_t frames;
+  jack_time_t usecs;
+  jack_nframes_t elapsed;
+
+  a2j_mock_cycle_read(client, &frames, &usecs);
+
+  /* the benchmark runs the next cycle late, not the clock early */
+  elapsed = (a2j_mock_jack_get_time() - usecs) * client->sample_rate / 1000000;
+  return frames + (elapsed < client->nframes ? elapsed : client->nframes - 1);
+}
+
+static
+jack_time_t
+a2j_mock_jack_frames_to_time(
+  const jack_client_t * client,
+  jack_nframes_t frames)
+{
+  jack_nframes_t cycle_frames;
+  jack_time_t usecs;
+
+  a2j_mock_cycle_read(client, &cycle_frames, &usecs);
+  return usecs + (int64_t)(int32_t)(frames - cycle_frames) * 1000000 / client->sample_rate;
+}
+
+static
+int
+a2j_mock_jack_get_cycle_times(
+  const jack_client_t * client,
+  jack_nframes_t * current_frames,
+  jack_time_t * current_usecs,
+  jack_time_t * next_usecs,
+  float * period_usecs)
+{
+  *period_usecs = (float)client->nframes * 1000000 / client->sample_rate;
+  *current_frames = client->cycle.frames;
+  *current_usecs = client->cycle.usecs;
+  *next_usecs = client->cycle.usecs + (jack_time_t)*period_usecs;
+  return 0;
+}
+
+/* JACK MIDI buffers */
+
+static
+void
+a2j_mock_jack_midi_clear_buffer(
+  void * port_buffer)
+{
+  struct a2j_mock_midi_buffer * buffer_ptr = port_buffer;
+
+  buffer_ptr->count = 0;
+  buffer_ptr->used = 0;
+}
+
+static
+uint32_t
+a2j_mock_jack_midi_get_event_count(
+  void * port_buffer)
+{
+  return ((struct a2j_mock_midi_buffer *)port_buffer)->count;
+}
+
+static
+int
+a2j_mock_jack_midi_event_get(
+  jack_midi_event_t * event,
+  void * port_buffer,
+  uint32_t event_index)
+{
+  struct a2j_mock_midi_buffer * buffer_ptr = port_buffer;
+
+  if (event_index >= buffer_ptr->count)
+  {
+    return -ENODATA;
+  }
+
+  event->time = buffer_ptr->events[event_index].time;
+  event->size = buffer_ptr->events[event_index].size;
+  event->buffer = buffer_ptr->data + buffer_ptr->events[event_index].offset;
+  return 0;
+}
+
+static
+size_t
+a2j_mock_jack_midi_max_event_size(
+  void * port_buffer)
+{
+  struct a2j_mock_midi_buffer * buffer_ptr = port_buffer;
+
+  if (buffer_ptr->count == A2J_MOCK_MIDI_BUFFER_EVENTS)
+  {
+    return 0;
+  }
+
+  return A2J_MOCK_MIDI_BUFFER_SIZE - buffer_ptr->used;
+}
+
+/* like the server, events must fit the period and come in time order */
+static
+jack_midi_data_t *
+a2j_mock_jack_midi_event_reserve(
+  void * port_buffer,
+  jack_nframes_t time,
+  size_t data_size)
+{
+  struct a2j_mock_midi_buffer * buffer_ptr = port_buffer;
+  struct a2j_mock_midi_event * event_ptr;
+
+  if (time >= g_mock_jack_client.nframes ||
+      (buffer_ptr->count > 0 && buffer_ptr->events[buffer_ptr->count - 1].time > time) ||
+      data_size > a2j_mock_jack_midi_max_event_size(port_buffer))
+  {
+    return NULL;
+  }
+
+  event_ptr = buffer_ptr->events + buffer_ptr->count++;
+  event_ptr->time = time;
+  event_ptr->offset = buffer_ptr->used;
+  event_ptr->size = data_size;
+  buffer_ptr->used += data_size;
+
+  return buffer_ptr->data + event_ptr->offset;
+}
+
+/* benchmark side */
+
+void
+a2j_mock_jack_cycle(void)
+{
+  jack_client_t * client = &g_mock_jack_client;
+  struct _jack_port * port;
+  jack_nframes_t frames;
+
+  if (!client->started)
+  {
+    if (client->thread_init != NULL)
+    {
+      client->thread_init(client->thread_init_arg);
+    }
+    client->started = true;
+    frames = 0;
+  }
+  else
+  {
+    frames = client->cycle.frames + client->nframes;
+  }
+
+  __atomic_store_n(&client->cycle.seq, client->cycle.seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  __atomic_store_n(&client->cycle.frames, frames, __ATOMIC_RELAXED);
+  __atomic_store_n(&client->cycle.usecs, a2j_mock_jack_get_time(), __ATOMIC_RELAXED);
+  __atomic_store_n(&client->cycle.seq, client->cycle.seq + 1, __ATOMIC_RELEASE);
+
+  if (client->process != NULL)
+  {
+    client->process(client->nframes, client->process_arg);
+  }
+
+  /* what was queued for the input ports has been seen */
+  for (port = client->ports; port != NULL; port = port->next)
+  {
+    if (port->flags & JackPortIsInput)
+    {
+      a2j_mock_jack_midi_clear_buffer(&port->buffer);
+    }
+  }
+}
+
+bool
+a2j_mock_jack_midi_add(
+  jack_port_t * port,
+  jack_nframes_t time,
+  const jack_midi_data_t * data,
+  size_t size)
+{
+  jack_midi_data_t * buffer;
+
+  buffer = a2j_mock_jack_midi_event_reserve(&port->buffer, time, size);
+  if (buffer == NULL)
+  {
+    return false;
+  }
+
+  memcpy(buffer, data, size);
+  return true;
+}
+
+uint32_t
+a2j_mock_jack_midi_count(
+  jack_port_t * port)
+{
+  return port->buffer.count;
+}
+
+const struct a2j_jack_ops g_a2j_mock_jack_ops =
+{
+  .client_open = a2j_mock_jack_client_open,
+  .get_buffer_size = a2j_mock_jack_get_buffer_size,
+  .get_sample_rate = a2j_mock_jack_get_sample_rate,
+
+  .set_process_callback = a2j_mock_jack_set_process_callback,
+  .set_thread_init_callback = a2j_mock_jack_set_thread_init_callback,
+  .set_freewheel_callback = a2j_mock_jack_set_freewheel_callback,
+  .set_buffer_size_callback = a2j_mock_jack_set_buffer_size_callback,
+  .set_latency_callback = a2j_mock_jack_set_latency_callback,
+  .on_shutdown = a2j_mock_jack_on_shutdown,
+
+  .port_register = a2j_mock_jack_port_register,
+  .port_unregister = a2j_mock_jack_port_unregister,
+  .port_get_buffer = a2j_mock_jack_port_get_buffer,
+  .port_name = a2j_mock_jack_port_name,
+  .port_set_latency_range = a2j_mock_jack_port_set_latency_range,
+  .recompute_total_latencies = a2j_mock_jack_recompute_total_latencies,
+
+  .get_time = a2j_mock_jack_get_time,
+  .frame_time = a2j_mock_jack_frame_time,
+  .last_frame_time = a2j_mock_jack_last_frame_time,
+  .frames_to_time = a2j_mock_jack_frames_to_time,
+  .get_cycle_times = a2j_mock_jack_get_cycle_times,
+
+  .midi_clear_buffer = a2j_mock_jack_midi_clear_buffer,
+  .midi_get_event_count = a2j_mock_jack_midi_get_event_count,
+  .midi_event_get = a2j_mock_jack_midi_event_get,
+  .midi_max_event_size = a2j_mock_jack_midi_max_event_size,
+  .midi_event_reserve = a2j_mock_jack_midi_event_reserve,
+};
@@ -0,0 +1,568 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * ALSA SEQ < - > JACK MIDI bridge
+ *
+ * Copyright (c) 2026 The a2jmidid authors
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ */
+
+/* The ALSA sequencer for benchmarks: a fixed set of client ports, an
+ * input queue filled by the benchmark and counters for what the bridge
+ * sends. The input thread polls an eventfd that injection signals, like
+ * it polls the sequencer device. Output goes through a buffer sized
+ * like the one of alsa-lib, so the writes to the device a real client
+ * would make are counted. */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <alsa/asoundlib.h>
+#include <jack/jack.h>
+#include <jack/midiport.h>
+
+#include "backend.h"
+#include "mock.h"
+
+#define A2J_MOCK_SEQ_QUEUE_SIZE 65536 /* events, power of two */
+#define A2J_MOCK_SEQ_PORTS      4096
+#define A2J_MOCK_SEQ_NAME_SIZE  64
+#define A2J_MOCK_SEQ_OUTPUT_SIZE (16 * 1024) /* alsa-lib default output buffer */
+
+struct a2j_mock_seq_port
+{
+  int client;
+  int port;
+  unsigned int caps;
+  unsigned int type;
+  char name[A2J_MOCK_SEQ_NAME_SIZE];
+};
+
+struct _snd_seq
+{
+  int eventfd;
+
+  /* single producer (the benchmark), single consumer (the ALSA input thread) */
+  snd_seq_event_t * queue;
+  size_t queue_head;
+  size_t queue_tail;
+  snd_seq_event_t input_event;  /* what the last event_input() returned */
+
+  /* bytes of events output and not drained yet, only the output thread writes */
+  size_t output_size;
+  size_t output_used;
+
+  struct a2j_mock_seq_port ports[A2J_MOCK_SEQ_PORTS];
+  unsigned int ports_count;     /* set up before the bridge threads start */
+
+  struct a2j_mock_seq_stats stats;
+};
+
+snd_seq_t *
+a2j_mock_seq_open(void)
+{
+  snd_seq_t * seq;
+
+  seq = calloc(1, sizeof(struct _snd_seq));
+  if (seq == NULL)
+  {
+    goto fail;
+  }
+
+  seq->queue = malloc(A2J_MOCK_SEQ_QUEUE_SIZE * sizeof(snd_seq_event_t));
+  if (seq->queue == NULL)
+  {
+    goto free_seq;
+  }
+
+  seq->output_size = A2J_MOCK_SEQ_OUTPUT_SIZE;
+
+  seq->eventfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (seq->eventfd < 0)
+  {
+    goto free_queue;
+  }
+
+  return seq;
+
+free_queue:
+  free(seq->queue);
+free_seq:
+  free(seq);
+fail:
+  return NULL;
+}
+
+void
+a2j_mock_seq_close(
+  snd_seq_t * seq)
+{
+  close(seq->eventfd);
+  free(seq->queue);
+  free(seq);
+}
+
+bool
+a2j_mock_seq_add_port(
+  snd_seq_t * seq,
+  int client,
+  int port,
+  const char * name,
+  unsigned int caps,
+  unsigned int type)
+{
+  struct a2j_mock_seq_port * port_ptr;
+
+  if (seq->ports_count == A2J_MOCK_SEQ_PORTS)
+  {
+    return false;
+  }
+
+  port_ptr = seq->ports + seq->ports_count++;
+  port_ptr->client = client;
+  port_ptr->port = port;
+  port_ptr->caps = caps;
+  port_ptr->type = type;
+  snprintf(port_ptr->name, sizeof(port_ptr->name), "%s", name);
+
+  return true;
+}
+
+size_t
+a2j_mock_seq_inject(
+  snd_seq_t * seq,
+  const snd_seq_event_t * events,
+  size_t count)
+{
+  size_t head;
+  size_t room;
+  size_t i;
+  uint64_t one = 1;
+  ssize_t ret;
+
+  head = seq->queue_head;
+  room = A2J_MOCK_SEQ_QUEUE_SIZE - (head - __atomic_load_n(&seq->queue_tail, __ATOMIC_ACQUIRE));
+  if (count > room)
+  {
+    count = room;
+  }
+
+  for (i = 0; i < count; i++)
+  {
+    seq->queue[(head + i) & (A2J_MOCK_SEQ_QUEUE_SIZE - 1)] = events[i];
+  }
+
+  __atomic_store_n(&seq->queue_head, head + count, __ATOMIC_RELEASE);
+
+  if (count > 0)
+  {
+    ret = write(seq->eventfd, &one, sizeof(one));
+    (void)ret;
+  }
+
+  return count;
+}
+
+size_t
+a2j_mock_seq_pending(
+  snd_seq_t * seq)
+{
+  return __atomic_load_n(&seq->queue_head, __ATOMIC_ACQUIRE) - __atomic_load_n(&seq->stats.input_events, __ATOMIC_ACQUIRE);
+}
+
+void
+a2j_mock_seq_stats(
+  snd_seq_t * seq,
+  struct a2j_mock_seq_stats * stats_ptr)
+{
+  stats_ptr->input_events = __atomic_load_n(&seq->stats.input_events, __ATOMIC_RELAXED);
+  stats_ptr->output_events = __atomic_load_n(&seq->stats.output_events, __ATOMIC_RELAXED);
+  stats_ptr->output_bytes = __atomic_load_n(&seq->stats.output_bytes, __ATOMIC_RELAXED);
+  stats_ptr->drains = __atomic_load_n(&seq->stats.drains, __ATOMIC_RELAXED);
+  stats_ptr->writes = __atomic_load_n(&seq->stats.writes, __ATOMIC_RELAXED);
+}
+
+static
+const struct a2j_mock_seq_port *
+a2j_mock_seq_find_port(
+  snd_seq_t * seq,
+  int client,
+  int port)
+{
+  unsigned int i;
+
+  for (i = 0; i < seq->ports_count; i++)
+  {
+    if (seq->ports[i].client == client && seq->ports[i].port == port)
+    {
+      return seq->ports + i;
+    }
+  }
+
+  return NULL;
+}
+
+static
+void
+a2j_mock_seq_fill_port_info(
+  const struct a2j_mock_seq_port * port_ptr,
+  snd_seq_port_info_t * info)
+{
+  snd_seq_port_info_set_client(info, port_ptr->client);
+  snd_seq_port_info_set_port(info, port_ptr->port);
+  snd_seq_port_info_set_name(info, port_ptr->name);
+  snd_seq_port_info_set_capability(info, port_ptr->caps);
+  snd_seq_port_info_set_type(info, port_ptr->type);
+}
+
+static
+void
+a2j_mock_seq_fill_client_info(
+  int client,
+  snd_seq_client_info_t * info)
+{
+  char name[A2J_MOCK_SEQ_NAME_SIZE];
+
+  snprintf(name, sizeof(name), "mock %d", client);
+  snd_seq_client_info_set_client(info, client);
+  snd_seq_client_info_set_name(info, name);
+}
+
+/* struct a2j_seq_ops */
+
+static
+int
+a2j_mock_seq_get_any_client_info(
+  snd_seq_t * seq,
+  int client,
+  snd_seq_client_info_t * info)
+{
+  unsigned int i;
+
+  for (i = 0; i < seq->ports_count; i++)
+  {
+    if (seq->ports[i].client == client)
+    {
+      a2j_mock_seq_fill_client_info(client, info);
+      return 0;
+    }
+  }
+
+  return -ENOENT;
+}
+
+static
+int
+a2j_mock_seq_get_any_port_info(
+  snd_seq_t * seq,
+  int client,
+  int port,
+  snd_seq_port_info_t * info)
+{
+  const struct a2j_mock_seq_port * port_ptr;
+
+  port_ptr = a2j_mock_seq_find_port(seq, client, port);
+  if (port_ptr == NULL)
+  {
+    return -ENOENT;
+  }
+
+  a2j_mock_seq_fill_port_info(port_ptr, info);
+  return 0;
+}
+
+static
+int
+a2j_mock_seq_query_next_client(
+  snd_seq_t * seq,
+  snd_seq_client_info_t * info)
+{
+  int current;
+  int next;
+  unsigned int i;
+
+  current = snd_seq_client_info_get_client(info);
+  next = -1;
+  for (i = 0; i < seq->ports_count; i++)
+  {
+    if (seq->ports[i].client > current && (next < 0 || seq->ports[i].client < next))
+    {
+      next = seq->ports[i].client;
+    }
+  }
+
+  if (next < 0)
+  {
+    return -ENOENT;
+  }
+
+  a2j_mock_seq_fill_client_info(next, info);
+  return 0;
+}
+
+static
+int
+a2j_mock_seq_query_next_port(
+  snd_seq_t * seq,
+  snd_seq_port_info_t * info)
+{
+  const struct a2j_mock_seq_port * next_ptr;
+  int client;
+  int current;
+  unsigned int i;
+
+  client = snd_seq_port_info_get_client(info);
+  current = snd_seq_port_info_get_port(info);
+  next_ptr = NULL;
+  for (i = 0; i < seq->ports_count; i++)
+  {
+    if (seq->ports[i].client == client &&
+        seq->ports[i].port > current &&
+        (next_ptr == NULL || seq->ports[i].port < next_ptr->port))
+    {
+      next_ptr = seq->ports + i;
+    }
+  }
+
+  if (next_ptr == NULL)
+  {
+    return -ENOENT;
+  }
+
+  a2j_mock_seq_fill_port_info(next_ptr, info);
+  return 0;
+}
+
+static
+int
+a2j_mock_seq_connect_to(
+  snd_seq_t * seq,
+  int my_port,
+  int dest_client,
+  int dest_port)
+{
+  return 0;
+}
+
+static
+int
+a2j_mock_seq_subscribe_port(
+  snd_seq_t * seq,
+  snd_seq_port_subscribe_t * sub)
+{
+  return 0;
+}
+
+static
+snd_seq_type_t
+a2j_mock_seq_type(
+  snd_seq_t * seq)
+{
+  /* not a kernel client, --raw-input falls back to alsa-lib reads */
+  return SND_SEQ_TYPE_INET;
+}
+
+static
+size_t
+a2j_mock_seq_get_input_buffer_size(
+  snd_seq_t * seq)
+{
+  return 65536;
+}
+
+static
+int
+a2j_mock_seq_poll_descriptors_count(
+  snd_seq_t * seq,
+  short events)
+{
+  return (events & POLLIN) ? 1 : 0;
+}
+
+/* output never runs out of room, so there is nothing to wait for with POLLOUT */
+static
+int
+a2j_mock_seq_poll_descriptors(
+  snd_seq_t * seq,
+  struct pollfd * pfds,
+  unsigned int space,
+  short events)
+{
+  if (space < 1 || !(events & POLLIN))
+  {
+    return 0;
+  }
+
+  pfds[0].fd = seq->eventfd;
+  pfds[0].events = POLLIN;
+  pfds[0].revents = 0;
+  return 1;
+}
+
+static
+int
+a2j_mock_seq_event_input(
+  snd_seq_t * seq,
+  snd_seq_event_t ** ev)
+{
+  size_t tail;
+  uint64_t counter;
+  ssize_t ret;
+
+  tail = seq->queue_tail;
+  if (tail == __atomic_load_n(&seq->queue_head, __ATOMIC_ACQUIRE))
+  {
+    /* rearm the wakeup first, an injection after it signals again */
+    ret = read(seq->eventfd, &counter, sizeof(counter));
+    (void)ret;
+
+    if (tail == __atomic_load_n(&seq->queue_head, __ATOMIC_ACQUIRE))
+    {
+      return -EAGAIN;
+    }
+  }
+
+  seq->input_event = seq->queue[tail & (A2J_MOCK_SEQ_QUEUE_SIZE - 1)];
+  __atomic_store_n(&seq->queue_tail, tail + 1, __ATOMIC_RELEASE);
+
+  *ev = &seq->input_event;
+  return 1;
+}
+
+/* the input thread frees an event once it is dispatched */
+static
+int
+a2j_mock_seq_free_event(
+  snd_seq_t * seq,
+  snd_seq_event_t * ev)
+{
+  __atomic_fetch_add(&seq->stats.input_events, 1, __ATOMIC_RELEASE);
+  return 0;
+}
+
+static
+void
+a2j_mock_seq_write(
+  snd_seq_t * seq)
+{
+  if (seq->output_used > 0)
+  {
+    __atomic_fetch_add(&seq->stats.writes, 1, __ATOMIC_RELAXED);
+    seq->output_used = 0;
+  }
+}
+
+int
+a2j_mock_seq_set_output_buffer_size(
+  snd_seq_t * seq,
+  size_t size)
+{
+  if (size < sizeof(snd_seq_event_t))
+  {
+    return -EINVAL;
+  }
+
+  a2j_mock_seq_write(seq);
+  seq->output_size = size;
+  return 0;
+}
+
+/* like alsa-lib, an event that does not fit writes out the buffer first */
+static
+int
+a2j_mock_seq_event_output(
+  snd_seq_t * seq,
+  snd_seq_event_t * ev)
+{
+  size_t size;
+
+  size = sizeof(snd_seq_event_t);
+  if (snd_seq_ev_is_variable(ev))
+  {
+    size += ev->data.ext.len;
+  }
+
+  if (size >= seq->output_size)
+  {
+    return -EINVAL;
+  }
+
+  if (seq->output_used + size > seq->output_size)
+  {
+    a2j_mock_seq_write(seq);
+  }
+
+  seq->output_used += size;
+  if (snd_seq_ev_is_variable(ev))
+  {
+    __atomic_fetch_add(&seq->stats.output_bytes, ev->data.ext.len, __ATOMIC_RELAXED);
+  }
+  __atomic_fetch_add(&seq->stats.output_events, 1, __ATOMIC_RELAXED);
+  return seq->output_used;
+}
+
+static
+int
+a2j_mock_seq_drain_output(
+  snd_seq_t * seq)
+{
+  __atomic_fetch_add(&seq->stats.drains, 1, __ATOMIC_RELAXED);
+  a2j_mock_seq_write(seq);
+  return 0;
+}
+
+/* the queue runs on the monotonic clock */
+static
+int
+a2j_mock_seq_get_queue_real_time(
+  snd_seq_t * seq,
+  int q,
+  snd_seq_real_time_t * time)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  time->tv_sec = ts.tv_sec;
+  time->tv_nsec = ts.tv_nsec;
+  return 0;
+}
+
+const struct a2j_seq_ops g_a2j_mock_seq_ops =
+{
+  .get_any_client_info = a2j_mock_seq_get_any_client_info,
+  .get_any_port_info = a2j_mock_seq_get_any_port_info,
+  .query_next_client = a2j_mock_seq_query_next_client,
+  .query_next_port = a2j_mock_seq_query_next_port,
+  .connect_to = a2j_mock_seq_connect_to,
+  .subscribe_port = a2j_mock_seq_subscribe_port,
+
+  .type = a2j_mock_seq_type,
+  .get_input_buffer_size = a2j_mock_seq_get_input_buffer_size,
+  .poll_descriptors_count = a2j_mock_seq_poll_descriptors_count,
+  .poll_descriptors = a2j_mock_seq_poll_descriptors,
+
+  .event_input = a2j_mock_seq_event_input,
+  .free_event = a2j_mock_seq_free_event,
+  .event_output = a2j_mock_seq_event_output,
+  .drain_output = a2j_mock_seq_drain_output,
+
+  .get_queue_real_time = a2j_mock_seq_get_queue_real_time,
+};
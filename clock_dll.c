@@ -0,0 +1,79 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * ALSA SEQ < - > JACK MIDI bridge
+ *
+ * Copyright (c) 2026 The a2jmidid authors
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "clock_dll.h"
+
+/* loop bandwidth, relative to the update rate. With updates every
+ * A2J_CLOCK_SAMPLE_USECS this settles within a few seconds. */
+#define A2J_DLL_OMEGA 0.2
+#define A2J_DLL_B (1.4142135623730951 * A2J_DLL_OMEGA)
+#define A2J_DLL_C (A2J_DLL_OMEGA * A2J_DLL_OMEGA)
+
+/* further apart than this, the samples are from before a stall and the loop starts over */
+#define A2J_DLL_MAX_GAP_USECS 10000000
+
+void
+a2j_clock_dll_init(
+  struct a2j_clock_dll * dll_ptr)
+{
+  dll_ptr->valid = false;
+  dll_ptr->rate = 1.0;
+}
+
+void
+a2j_clock_dll_update(
+  struct a2j_clock_dll * dll_ptr,
+  int64_t local,
+  int64_t reference)
+{
+  int64_t delta;
+  double predicted;
+  double error;
+
+  delta = local - dll_ptr->local;
+
+  if (!dll_ptr->valid || delta <= 0 || delta > A2J_DLL_MAX_GAP_USECS)
+  {
+    dll_ptr->valid = true;
+    dll_ptr->local = local;
+    dll_ptr->reference = reference;
+    dll_ptr->rate = 1.0;
+    return;
+  }
+
+  predicted = dll_ptr->reference + dll_ptr->rate * delta;
+  error = reference - predicted;
+
+  dll_ptr->local = local;
+  dll_ptr->reference = predicted + A2J_DLL_B * error;
+  dll_ptr->rate += A2J_DLL_C * error / delta;
+}
+
+/* reference time at local time, extrapolated from the last update */
+int64_t
+a2j_clock_dll_map(
+  const struct a2j_clock_dll * dll_ptr,
+  int64_t local)
+{
+  return (int64_t)(dll_ptr->reference + dll_ptr->rate * (local - dll_ptr->local));
+}
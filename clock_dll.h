@@ -0,0 +1,50 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * ALSA SEQ < - > JACK MIDI bridge
+ *
+ * Copyright (c) 2026 The a2jmidid authors
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ */
+
+#ifndef CLOCK_DLL_H__D873F997_A982_4997_A911_0C23ADC8D01A__INCLUDED
+#define CLOCK_DLL_H__D873F997_A982_4997_A911_0C23ADC8D01A__INCLUDED
+
+/* Second order delay locked loop tracking a reference clock (JACK
+ * time, usecs) against a local one (ALSA queue real time, usecs) from
+ * occasional pairs of samples of both. */
+struct a2j_clock_dll
+{
+  bool valid;
+  int64_t local;                /* local time of the last update */
+  double reference;             /* filtered reference time at local */
+  double rate;                  /* reference usecs per local usec */
+};
+
+void
+a2j_clock_dll_init(
+  struct a2j_clock_dll * dll_ptr);
+
+void
+a2j_clock_dll_update(
+  struct a2j_clock_dll * dll_ptr,
+  int64_t local,
+  int64_t reference);
+
+int64_t
+a2j_clock_dll_map(
+  const struct a2j_clock_dll * dll_ptr,
+  int64_t local);
+
+#endif /* #ifndef CLOCK_DLL_H__D873F997_A982_4997_A911_0C23ADC8D01A__INCLUDED */
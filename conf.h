@@ -23,7 +23,18 @@
 
 extern bool g_a2j_export_hw_ports;
 extern bool g_disable_port_uniqueness;
+extern bool g_a2j_kernel_scheduling;
+extern size_t g_a2j_output_buffer_size;
+extern unsigned int g_a2j_spin_usecs;
+extern size_t g_a2j_max_event_size;
+extern bool g_a2j_lock_memory;
+extern bool g_a2j_raw_input;
+extern unsigned int g_a2j_input_delay;
+extern bool g_a2j_input_delay_adaptive;
+extern unsigned int g_a2j_output_delay;
+extern bool g_a2j_output_delay_period;
 extern char * g_a2j_jack_server_name;
+extern char * g_a2j_trace_path;
 
 void
 a2j_conf_save();
@@ -19,6 +19,8 @@
  */
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
 #include <dbus/dbus.h>
 #include <alsa/asoundlib.h>
 #include <jack/jack.h>
@@ -32,6 +34,7 @@
 #include "structs.h"
 #include "port_thread.h"
 #include "conf.h"
+#include "memlock.h"
 
 #define INTERFACE_NAME "org.gna.home.a2jmidid.control"
 
@@ -380,6 +383,324 @@ fail:
 	a2j_error("Ran out of memory trying to construct method return");
 }
 
+static
+bool
+a2j_dbus_append_port_latency(
+  DBusMessageIter * array_iter_ptr,
+  struct a2j_port * port_ptr,
+  dbus_bool_t playback)
+{
+  struct a2j_histogram histogram;
+  DBusMessageIter struct_iter;
+  DBusMessageIter buckets_iter;
+  const char * name;
+  dbus_uint64_t count;
+  dbus_int64_t min;
+  dbus_int64_t avg;
+  dbus_int64_t max;
+  const dbus_uint64_t * buckets;
+
+  a2j_histogram_read(&port_ptr->latency, &histogram);
+
+  name = port_ptr->name;
+  count = histogram.count;
+  min = count > 0 ? histogram.min : 0;
+  avg = count > 0 ? histogram.sum / (int64_t)count : 0;
+  max = count > 0 ? histogram.max : 0;
+  buckets = (const dbus_uint64_t *)histogram.buckets;
+
+  if (!dbus_message_iter_open_container(array_iter_ptr, DBUS_TYPE_STRUCT, NULL, &struct_iter))
+  {
+    return false;
+  }
+
+  if (!dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_STRING, &name) ||
+      !dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_BOOLEAN, &playback) ||
+      !dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64, &count) ||
+      !dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_INT64, &min) ||
+      !dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_INT64, &avg) ||
+      !dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_INT64, &max))
+  {
+    goto fail_abandon;
+  }
+
+  if (!dbus_message_iter_open_container(&struct_iter, DBUS_TYPE_ARRAY, DBUS_TYPE_UINT64_AS_STRING, &buckets_iter))
+  {
+    goto fail_abandon;
+  }
+
+  if (!dbus_message_iter_append_fixed_array(&buckets_iter, DBUS_TYPE_UINT64, &buckets, A2J_HISTOGRAM_BUCKETS) ||
+      !dbus_message_iter_close_container(&struct_iter, &buckets_iter))
+  {
+    dbus_message_iter_abandon_container(&struct_iter, &buckets_iter);
+    goto fail_abandon;
+  }
+
+  return dbus_message_iter_close_container(array_iter_ptr, &struct_iter);
+
+fail_abandon:
+  dbus_message_iter_abandon_container(array_iter_ptr, &struct_iter);
+  return false;
+}
+
+/* usecs histograms, buckets are log2 as described in histogram.h; updated by the realtime threads while we read */
+static
+void
+a2j_dbus_get_latency_histograms(
+  struct a2j_dbus_method_call * call_ptr)
+{
+  DBusMessageIter iter;
+  DBusMessageIter array_iter;
+  struct list_head * node_ptr;
+  int type;
+
+  if (!a2j_is_started())
+  {
+    a2j_dbus_error(call_ptr, A2J_DBUS_ERROR_BRIDGE_NOT_RUNNING, "Bridge not started");
+    return;
+  }
+
+  call_ptr->reply = dbus_message_new_method_return(call_ptr->message);
+  if (call_ptr->reply == NULL)
+  {
+    goto fail;
+  }
+
+  dbus_message_iter_init_append(call_ptr->reply, &iter);
+
+  if (!dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, "(sbtxxxat)", &array_iter))
+  {
+    goto fail_unref;
+  }
+
+  for (type = A2J_PORT_CAPTURE; type <= A2J_PORT_PLAYBACK; type++)
+  {
+    list_for_each(node_ptr, &g_a2j->stream[type].list)
+    {
+      if (!a2j_dbus_append_port_latency(&array_iter, list_entry(node_ptr, struct a2j_port, siblings), type == A2J_PORT_PLAYBACK))
+      {
+        dbus_message_iter_abandon_container(&iter, &array_iter);
+        goto fail_unref;
+      }
+    }
+  }
+
+  if (!dbus_message_iter_close_container(&iter, &array_iter))
+  {
+    goto fail_unref;
+  }
+
+  return;
+
+fail_unref:
+  dbus_message_unref(call_ptr->reply);
+  call_ptr->reply = NULL;
+
+fail:
+  a2j_error("Ran out of memory trying to construct method return");
+}
+
+static
+bool
+a2j_dbus_append_counter(
+  DBusMessageIter * dict_iter_ptr,
+  const char * name,
+  dbus_uint64_t value)
+{
+  DBusMessageIter entry_iter;
+
+  if (!dbus_message_iter_open_container(dict_iter_ptr, DBUS_TYPE_DICT_ENTRY, NULL, &entry_iter))
+  {
+    return false;
+  }
+
+  if (!dbus_message_iter_append_basic(&entry_iter, DBUS_TYPE_STRING, &name) ||
+      !dbus_message_iter_append_basic(&entry_iter, DBUS_TYPE_UINT64, &value))
+  {
+    dbus_message_iter_abandon_container(dict_iter_ptr, &entry_iter);
+    return false;
+  }
+
+  return dbus_message_iter_close_container(dict_iter_ptr, &entry_iter);
+}
+
+/* counters of stats_ptr as a{st}, keyed by the struct a2j_port_stats field names */
+static
+bool
+a2j_dbus_append_port_stats(
+  DBusMessageIter * iter_ptr,
+  const struct a2j_port_stats * stats_ptr)
+{
+  DBusMessageIter dict_iter;
+  unsigned int i;
+
+  if (!dbus_message_iter_open_container(iter_ptr, DBUS_TYPE_ARRAY, "{st}", &dict_iter))
+  {
+    return false;
+  }
+
+  for (i = 0; i < A2J_PORT_STATS_COUNTERS; i++)
+  {
+    if (!a2j_dbus_append_counter(&dict_iter, g_a2j_port_stats_counters[i].name, *(const uint64_t *)((const char *)stats_ptr + g_a2j_port_stats_counters[i].offset)))
+    {
+      dbus_message_iter_abandon_container(iter_ptr, &dict_iter);
+      return false;
+    }
+  }
+
+  return dbus_message_iter_close_container(iter_ptr, &dict_iter);
+}
+
+static
+void
+a2j_dbus_get_statistics(
+  struct a2j_dbus_method_call * call_ptr)
+{
+  DBusMessageIter iter;
+  DBusMessageIter dict_iter;
+  DBusMessageIter array_iter;
+  DBusMessageIter struct_iter;
+  struct list_head * node_ptr;
+  struct a2j_port * port_ptr;
+  struct a2j_port_stats stats;
+  struct a2j_port_stats totals[2];
+  dbus_uint64_t port_count[2];
+  unsigned long minor_faults;
+  unsigned long major_faults;
+  pthread_t threads[3];
+  const char * thread_counters[3];
+  uint64_t cpu_nsecs;
+  unsigned int i;
+  const char * name;
+  dbus_bool_t playback;
+  int type;
+
+  if (!a2j_is_started())
+  {
+    a2j_dbus_error(call_ptr, A2J_DBUS_ERROR_BRIDGE_NOT_RUNNING, "Bridge not started");
+    return;
+  }
+
+  call_ptr->reply = dbus_message_new_method_return(call_ptr->message);
+  if (call_ptr->reply == NULL)
+  {
+    goto fail;
+  }
+
+  dbus_message_iter_init_append(call_ptr->reply, &iter);
+
+  /* stream totals include ports that are already gone */
+  for (type = A2J_PORT_CAPTURE; type <= A2J_PORT_PLAYBACK; type++)
+  {
+    totals[type] = g_a2j->stats.retired[type];
+    port_count[type] = 0;
+    list_for_each(node_ptr, &g_a2j->stream[type].list)
+    {
+      a2j_port_stats_read(&list_entry(node_ptr, struct a2j_port, siblings)->stats, &stats);
+      a2j_port_stats_accumulate(totals + type, &stats);
+      port_count[type]++;
+    }
+  }
+
+  if (!dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, "{st}", &dict_iter))
+  {
+    goto fail_unref;
+  }
+
+  if (!a2j_dbus_append_counter(&dict_iter, "port_events_dropped", __atomic_load_n(&g_a2j->stats.port_events_dropped, __ATOMIC_RELAXED)) ||
+      !a2j_dbus_append_counter(&dict_iter, "drain_errors", __atomic_load_n(&g_a2j->stats.drain_errors, __ATOMIC_RELAXED)) ||
+      !a2j_dbus_append_counter(&dict_iter, "capture_ports", port_count[A2J_PORT_CAPTURE]) ||
+      !a2j_dbus_append_counter(&dict_iter, "playback_ports", port_count[A2J_PORT_PLAYBACK]))
+  {
+    dbus_message_iter_abandon_container(&iter, &dict_iter);
+    goto fail_unref;
+  }
+
+  if (a2j_rt_faults(g_a2j, &minor_faults, &major_faults) &&
+      (!a2j_dbus_append_counter(&dict_iter, "rt_minor_faults", minor_faults) ||
+       !a2j_dbus_append_counter(&dict_iter, "rt_major_faults", major_faults)))
+  {
+    dbus_message_iter_abandon_container(&iter, &dict_iter);
+    goto fail_unref;
+  }
+
+  /* CPU time of the bridge threads, sampled before and after a load gives its cost */
+  threads[0] = g_a2j->alsa_input_thread;
+  thread_counters[0] = "input_thread_cpu_ns";
+  threads[1] = jack_client_thread_id(g_a2j->jack_client);
+  thread_counters[1] = "process_thread_cpu_ns";
+  threads[2] = g_a2j->alsa_output_thread;
+  thread_counters[2] = "output_thread_cpu_ns";
+
+  for (i = 0; i < 3; i++)
+  {
+    if (a2j_thread_cpu_nsecs(threads[i], &cpu_nsecs) &&
+        !a2j_dbus_append_counter(&dict_iter, thread_counters[i], cpu_nsecs))
+    {
+      dbus_message_iter_abandon_container(&iter, &dict_iter);
+      goto fail_unref;
+    }
+  }
+
+  if (!dbus_message_iter_close_container(&iter, &dict_iter))
+  {
+    goto fail_unref;
+  }
+
+  if (!a2j_dbus_append_port_stats(&iter, totals + A2J_PORT_CAPTURE) ||
+      !a2j_dbus_append_port_stats(&iter, totals + A2J_PORT_PLAYBACK))
+  {
+    goto fail_unref;
+  }
+
+  if (!dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, "(sba{st})", &array_iter))
+  {
+    goto fail_unref;
+  }
+
+  for (type = A2J_PORT_CAPTURE; type <= A2J_PORT_PLAYBACK; type++)
+  {
+    playback = type == A2J_PORT_PLAYBACK;
+    list_for_each(node_ptr, &g_a2j->stream[type].list)
+    {
+      port_ptr = list_entry(node_ptr, struct a2j_port, siblings);
+      name = port_ptr->name;
+      a2j_port_stats_read(&port_ptr->stats, &stats);
+
+      if (!dbus_message_iter_open_container(&array_iter, DBUS_TYPE_STRUCT, NULL, &struct_iter))
+      {
+        goto fail_abandon;
+      }
+
+      if (!dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_STRING, &name) ||
+          !dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_BOOLEAN, &playback) ||
+          !a2j_dbus_append_port_stats(&struct_iter, &stats) ||
+          !dbus_message_iter_close_container(&array_iter, &struct_iter))
+      {
+        dbus_message_iter_abandon_container(&array_iter, &struct_iter);
+        goto fail_abandon;
+      }
+    }
+  }
+
+  if (!dbus_message_iter_close_container(&iter, &array_iter))
+  {
+    goto fail_unref;
+  }
+
+  return;
+
+fail_abandon:
+  dbus_message_iter_abandon_container(&iter, &array_iter);
+
+fail_unref:
+  dbus_message_unref(call_ptr->reply);
+  call_ptr->reply = NULL;
+
+fail:
+  a2j_error("Ran out of memory trying to construct method return");
+}
+
 A2J_DBUS_METHOD_ARGUMENTS_BEGIN(exit)
 A2J_DBUS_METHOD_ARGUMENTS_END
 
@@ -428,6 +749,17 @@ A2J_DBUS_METHOD_ARGUMENTS_BEGIN(get_disable_port_uniqueness)
   A2J_DBUS_METHOD_ARGUMENT("disable_port_uniqueness", DBUS_TYPE_BOOLEAN_AS_STRING, A2J_DBUS_DIRECTION_OUT)
 A2J_DBUS_METHOD_ARGUMENTS_END
 
+A2J_DBUS_METHOD_ARGUMENTS_BEGIN(get_latency_histograms)
+  A2J_DBUS_METHOD_ARGUMENT("ports", "a(sbtxxxat)", A2J_DBUS_DIRECTION_OUT)
+A2J_DBUS_METHOD_ARGUMENTS_END
+
+A2J_DBUS_METHOD_ARGUMENTS_BEGIN(get_statistics)
+  A2J_DBUS_METHOD_ARGUMENT("bridge", "a{st}", A2J_DBUS_DIRECTION_OUT)
+  A2J_DBUS_METHOD_ARGUMENT("capture", "a{st}", A2J_DBUS_DIRECTION_OUT)
+  A2J_DBUS_METHOD_ARGUMENT("playback", "a{st}", A2J_DBUS_DIRECTION_OUT)
+  A2J_DBUS_METHOD_ARGUMENT("ports", "a(sba{st})", A2J_DBUS_DIRECTION_OUT)
+A2J_DBUS_METHOD_ARGUMENTS_END
+
 A2J_DBUS_METHODS_BEGIN
   A2J_DBUS_METHOD_DESCRIBE(exit, a2j_dbus_exit)
   A2J_DBUS_METHOD_DESCRIBE(start, a2j_dbus_start)
@@ -440,6 +772,8 @@ A2J_DBUS_METHODS_BEGIN
   A2J_DBUS_METHOD_DESCRIBE(get_hw_export, a2j_dbus_get_hw_export)
   A2J_DBUS_METHOD_DESCRIBE(set_disable_port_uniqueness, a2j_dbus_set_disable_port_uniqueness)
   A2J_DBUS_METHOD_DESCRIBE(get_disable_port_uniqueness, a2j_dbus_get_disable_port_uniqueness)
+  A2J_DBUS_METHOD_DESCRIBE(get_latency_histograms, a2j_dbus_get_latency_histograms)
+  A2J_DBUS_METHOD_DESCRIBE(get_statistics, a2j_dbus_get_statistics)
 A2J_DBUS_METHODS_END
 
 A2J_DBUS_SIGNAL_ARGUMENTS_BEGIN(bridge_started)
@@ -0,0 +1,193 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * ALSA SEQ < - > JACK MIDI bridge
+ *
+ * Copyright (c) 2026 The a2jmidid authors
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "histogram.h"
+#include "log.h"
+
+void
+a2j_histogram_reset(
+  struct a2j_histogram * histogram_ptr)
+{
+  memset(histogram_ptr, 0, sizeof(struct a2j_histogram));
+  histogram_ptr->min = INT64_MAX;
+  histogram_ptr->max = INT64_MIN;
+}
+
+static
+unsigned int
+a2j_histogram_bucket(
+  int64_t usecs)
+{
+  unsigned int bucket;
+
+  bucket = 0;
+  while (usecs > 0 && bucket < A2J_HISTOGRAM_BUCKETS - 1)
+  {
+    usecs >>= 1;
+    bucket++;
+  }
+
+  return bucket;
+}
+
+/* may run concurrently with a2j_histogram_read(), each field is updated atomically but not the set as a whole */
+void
+a2j_histogram_add(
+  struct a2j_histogram * histogram_ptr,
+  int64_t usecs)
+{
+  int64_t old;
+
+  __atomic_fetch_add(&histogram_ptr->buckets[a2j_histogram_bucket(usecs)], 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&histogram_ptr->sum, usecs, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&histogram_ptr->count, 1, __ATOMIC_RELAXED);
+
+  old = __atomic_load_n(&histogram_ptr->min, __ATOMIC_RELAXED);
+  while (usecs < old &&
+         !__atomic_compare_exchange_n(&histogram_ptr->min, &old, usecs, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+  {
+  }
+
+  old = __atomic_load_n(&histogram_ptr->max, __ATOMIC_RELAXED);
+  while (usecs > old &&
+         !__atomic_compare_exchange_n(&histogram_ptr->max, &old, usecs, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+  {
+  }
+}
+
+void
+a2j_histogram_read(
+  const struct a2j_histogram * histogram_ptr,
+  struct a2j_histogram * snapshot_ptr)
+{
+  unsigned int i;
+
+  for (i = 0; i < A2J_HISTOGRAM_BUCKETS; i++)
+  {
+    snapshot_ptr->buckets[i] = __atomic_load_n(&histogram_ptr->buckets[i], __ATOMIC_RELAXED);
+  }
+
+  snapshot_ptr->count = __atomic_load_n(&histogram_ptr->count, __ATOMIC_RELAXED);
+  snapshot_ptr->sum = __atomic_load_n(&histogram_ptr->sum, __ATOMIC_RELAXED);
+  snapshot_ptr->min = __atomic_load_n(&histogram_ptr->min, __ATOMIC_RELAXED);
+  snapshot_ptr->max = __atomic_load_n(&histogram_ptr->max, __ATOMIC_RELAXED);
+}
+
+int64_t
+a2j_histogram_percentile(
+  const struct a2j_histogram * snapshot_ptr,
+  unsigned int percent)
+{
+  uint64_t threshold;
+  uint64_t count;
+  unsigned int i;
+  int64_t low;
+  int64_t high;
+  int64_t value;
+
+  if (snapshot_ptr->count == 0)
+  {
+    return 0;
+  }
+
+  threshold = (snapshot_ptr->count * percent + 99) / 100;
+  count = 0;
+  for (i = 0; i < A2J_HISTOGRAM_BUCKETS; i++)
+  {
+    if (count + snapshot_ptr->buckets[i] >= threshold && snapshot_ptr->buckets[i] != 0)
+    {
+      break;
+    }
+
+    count += snapshot_ptr->buckets[i];
+  }
+
+  if (i == A2J_HISTOGRAM_BUCKETS)
+  {
+    return snapshot_ptr->max;
+  }
+
+  /* samples are assumed spread evenly over the bucket, whose edges are narrowed to the extremes seen */
+  low = i == 0 ? snapshot_ptr->min : (int64_t)1 << (i - 1);
+  high = i == A2J_HISTOGRAM_BUCKETS - 1 ? snapshot_ptr->max : (int64_t)1 << i;
+  if (low < snapshot_ptr->min)
+  {
+    low = snapshot_ptr->min;
+  }
+  if (high > snapshot_ptr->max)
+  {
+    high = snapshot_ptr->max;
+  }
+
+  value = low + (int64_t)((double)(high - low) * (threshold - count) / snapshot_ptr->buckets[i]);
+  return value < high ? value : high;
+}
+
+void
+a2j_histogram_log(
+  const struct a2j_histogram * histogram_ptr,
+  const char * name)
+{
+  struct a2j_histogram snapshot;
+  unsigned int i;
+
+  a2j_histogram_read(histogram_ptr, &snapshot);
+  histogram_ptr = &snapshot;
+
+  if (histogram_ptr->count == 0)
+  {
+    a2j_info("%s: no samples", name);
+    return;
+  }
+
+  a2j_info(
+    "%s: %" PRIu64 " samples, min %" PRId64 " us, avg %" PRId64 " us, max %" PRId64 " us",
+    name,
+    histogram_ptr->count,
+    histogram_ptr->min,
+    histogram_ptr->sum / (int64_t)histogram_ptr->count,
+    histogram_ptr->max);
+
+  for (i = 0; i < A2J_HISTOGRAM_BUCKETS; i++)
+  {
+    if (histogram_ptr->buckets[i] == 0)
+    {
+      continue;
+    }
+
+    if (i == 0)
+    {
+      a2j_info("  < 1 us: %" PRIu64, histogram_ptr->buckets[i]);
+    }
+    else if (i == A2J_HISTOGRAM_BUCKETS - 1)
+    {
+      a2j_info("  >= %u us: %" PRIu64, 1U << (i - 1), histogram_ptr->buckets[i]);
+    }
+    else
+    {
+      a2j_info("  < %u us: %" PRIu64, 1U << i, histogram_ptr->buckets[i]);
+    }
+  }
+}
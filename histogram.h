@@ -0,0 +1,61 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * ALSA SEQ < - > JACK MIDI bridge
+ *
+ * Copyright (c) 2026 The a2jmidid authors
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ */
+
+#ifndef HISTOGRAM_H__5B7EB855_A98E_4501_9AD2_F28145EE8FC5__INCLUDED
+#define HISTOGRAM_H__5B7EB855_A98E_4501_9AD2_F28145EE8FC5__INCLUDED
+
+/* bucket 0 counts values below 1 usec, bucket i counts [2^(i-1), 2^i) usecs, the last one is open ended */
+#define A2J_HISTOGRAM_BUCKETS 20
+
+struct a2j_histogram
+{
+  uint64_t buckets[A2J_HISTOGRAM_BUCKETS];
+  uint64_t count;
+  int64_t sum;
+  int64_t min;
+  int64_t max;
+};
+
+void
+a2j_histogram_reset(
+  struct a2j_histogram * histogram_ptr);
+
+void
+a2j_histogram_add(
+  struct a2j_histogram * histogram_ptr,
+  int64_t usecs);
+
+void
+a2j_histogram_read(
+  const struct a2j_histogram * histogram_ptr,
+  struct a2j_histogram * snapshot_ptr);
+
+/* of a snapshot; interpolated within the bucket the percentile falls in */
+int64_t
+a2j_histogram_percentile(
+  const struct a2j_histogram * snapshot_ptr,
+  unsigned int percent);
+
+void
+a2j_histogram_log(
+  const struct a2j_histogram * histogram_ptr,
+  const char * name);
+
+#endif /* #ifndef HISTOGRAM_H__5B7EB855_A98E_4501_9AD2_F28145EE8FC5__INCLUDED */
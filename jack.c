@@ -21,6 +21,12 @@
 
 #include <stdbool.h>
 #include <time.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/timerfd.h>
 #include <alsa/asoundlib.h>
 #include <jack/jack.h>
 #include <jack/midiport.h>
@@ -30,30 +36,63 @@
 #include "structs.h"
 #include "jack.h"
 #include "log.h"
-#include "port_hash.h"
+#include "port_table.h"
 #include "port.h"
 #include "a2jmidid.h"
 #include "port_thread.h"
+#include "conf.h"
+#include "memlock.h"
+#include "trace.h"
+#include "midi_codec.h"
+#include "ringbuffer_vector.h"
 
 static bool g_freewheeling = false;
 
+/* frame times wrap around, order them by their distance instead */
+#define a2j_frames_before(a, b) ((int32_t)((a) - (b)) < 0)
+
 /*
- * =================== Input/output port handling =========================
+ * ============================ Input ==============================
  */
 
-void a2j_add_ports(struct a2j_stream * str)
+/* deliver reassembled SysEx deferred by earlier cycles, at the start of the period */
+static
+void
+a2j_sysex_flush(
+  struct a2j * self,
+  struct a2j_port * port)
 {
-  struct a2j_port * port_ptr;
-  while (jack_ringbuffer_read(str->new_ports, (char *)&port_ptr, sizeof(port_ptr)))
-  {
-    a2j_debug("jack: inserted port %s", port_ptr->name);
-    a2j_port_insert(str->port_hash, port_ptr);
+  struct a2j_sysex_buffer * sysex_ptr;
+  jack_midi_data_t * buf;
+
+  while (port->sysex_pending_count > 0) {
+    sysex_ptr = port->sysex_pending[port->sysex_pending_head];
+
+    if (sysex_ptr->size > self->backend.jack->midi_max_event_size (port->jack_buf)) {
+      if (self->backend.jack->midi_get_event_count (port->jack_buf) > 0) {
+        /* try again with an empty port buffer */
+        break;
+      }
+
+      /* does not fit even in an empty port buffer */
+      A2J_STAT_INC (port->stats.dropped_jack_buffer);
+    } else {
+      buf = self->backend.jack->midi_event_reserve (port->jack_buf, 0, sysex_ptr->size);
+      if (buf == NULL) {
+        break;
+      }
+
+      memcpy (buf, sysex_ptr->data, sysex_ptr->size);
+      A2J_STAT_INC (port->stats.events);
+      A2J_STAT_ADD (port->stats.bytes, sysex_ptr->size);
+    }
+
+    port->sysex_pending_head = (port->sysex_pending_head + 1) % A2J_SYSEX_POOL_SIZE;
+    port->sysex_pending_count--;
+    a2j_sysex_put (&self->sysex_pool, sysex_ptr);
   }
 }
 
-/*
- * ============================ Input ==============================
- */
 void
 a2j_process_incoming (
   struct a2j * self,
@@ -61,9 +100,14 @@ a2j_process_incoming (
   jack_nframes_t nframes)
 {
   struct a2j_alsa_midi_event ev;
-  jack_nframes_t now;
-  jack_nframes_t one_period;
-  char *ev_buf;
+  jack_nframes_t delay;
+  jack_nframes_t sample_rate;
+  jack_ringbuffer_data_t vec[2];
+  jack_ringbuffer_data_t next[2];
+  size_t visible;
+  size_t consumed;
+  int32_t position;
+  int32_t age;
 
   /* grab data queued by the ALSA input thread and write it into the JACK
      port buffer. it will delivered during the JACK period that this
@@ -75,51 +119,115 @@ a2j_process_incoming (
 
   // a2j_debug ("PORT: %s process input", jack_port_name (port->jack_port));
 
-  jack_midi_clear_buffer (port->jack_buf);
+  self->backend.jack->midi_clear_buffer (port->jack_buf);
+
+  /* SysEx left over from earlier cycles go first, while the port buffer is empty */
+  a2j_sysex_flush (self, port);
+
+  delay = self->input_delay;
+  sample_rate = self->backend.jack->get_sample_rate (self->jack_client);
 
-  now = jack_frame_time (self->jack_client);
-  one_period = jack_get_buffer_size (self->jack_client);
+  /* events are copied straight from the ringbuffer segments into the
+     reserved JACK event, the read pointer is advanced once at the end */
+  jack_ringbuffer_get_read_vector (port->inbound_events, vec);
+  visible = vec[0].len + vec[1].len;
+  consumed = 0;
 
-  while (jack_ringbuffer_peek (port->inbound_events, (char*)&ev, sizeof(ev) ) == sizeof(ev) ) {
+  while (vec[0].len + vec[1].len >= sizeof(ev)) {
 
     jack_midi_data_t* buf;
     jack_nframes_t offset;
 
-    if (ev.time >= self->cycle_start) {
+    memcpy (next, vec, sizeof(next));
+    a2j_read_vector_copy (next, &ev, sizeof(ev));
+
+    if (ev.sysex == NULL && next[0].len + next[1].len < ev.size)
       break;
+
+    if (consumed >= port->inbound_seen) {
+      /* first cycle the event is visible in, it would be late with any smaller delay */
+      age = (int32_t)(self->cycle_start - (jack_nframes_t)ev.time);
+      if (age > self->input_age_max) {
+        self->input_age_max = age;
+      }
     }
-    
-    //jack_ringbuffer_read_advance (port->inbound_events, sizeof (ev));
-    ev_buf = (char *) alloca( sizeof(ev) + ev.size );
 
-    if (jack_ringbuffer_peek (port->inbound_events, ev_buf, sizeof(ev) + ev.size ) != sizeof(ev) + ev.size)
+    /* every event is delivered delay frames after it arrived */
+    position = (int32_t)((jack_nframes_t)ev.time + delay - self->cycle_start);
+    if (position >= (int32_t)nframes) {
+      /* due in a later cycle, and so is everything behind it */
       break;
+    }
 
-    offset = self->cycle_start - ev.time;
-    if (offset > one_period) {
-      /* from a previous cycle, somehow. cram it in at the front */
+    if (position < 0) {
+      /* past its frame already. cram it in at the front */
       offset = 0;
+      A2J_STAT_INC (port->stats.late);
     } else {
-      /* offset from start of the current cycle */
-      offset = one_period - offset;
+      offset = position;
     }
 
     a2j_debug ("event at %d offset %d", ev.time, offset);
 
+    /* frames between arrival and the position it gets in the JACK buffer */
+    a2j_histogram_add (&port->latency, (int64_t)(int32_t)(self->cycle_start + offset - (jack_nframes_t)ev.time) * 1000000 / sample_rate);
+
+    if (ev.sysex != NULL) {
+      /* reassembled SysEx, if it does not fit now it waits for a later cycle, events behind it do not */
+      if (port->sysex_pending_count == 0 &&
+          (buf = self->backend.jack->midi_event_reserve (port->jack_buf, offset, ev.size)) != NULL) {
+        memcpy (buf, ev.sysex->data, ev.size);
+        A2J_STAT_INC (port->stats.events);
+        A2J_STAT_ADD (port->stats.bytes, ev.size);
+        a2j_sysex_put (&self->sysex_pool, ev.sysex);
+      } else {
+        port->sysex_pending[(port->sysex_pending_head + port->sysex_pending_count++) % A2J_SYSEX_POOL_SIZE] = ev.sysex;
+      }
+
+      memcpy (vec, next, sizeof(next));
+      consumed += sizeof(ev);
+      continue;
+    }
+
     /* make sure there is space for it */
     
-    buf = jack_midi_event_reserve (port->jack_buf, offset, ev.size);
+    buf = self->backend.jack->midi_event_reserve (port->jack_buf, offset, ev.size);
 
     if (buf) {
       /* grab the event */
-      memcpy( buf, ev_buf + sizeof(ev), ev.size );
+      a2j_read_vector_copy (next, buf, ev.size);
+      A2J_STAT_INC (port->stats.events);
+      A2J_STAT_ADD (port->stats.bytes, ev.size);
     } else {
       /* throw it away (no space) */
+      a2j_read_vector_copy (next, NULL, ev.size);
+      A2J_STAT_INC (port->stats.dropped_jack_buffer);
       a2j_error ("threw away MIDI event - not reserved at time %d", ev.time);
     }
-    jack_ringbuffer_read_advance (port->inbound_events, sizeof(ev) + ev.size);
+
+    memcpy (vec, next, sizeof(next));
+    consumed += sizeof(ev) + ev.size;
     
-    a2j_debug("input on %s: sucked %d bytes from inbound at %d", jack_port_name (port->jack_port), ev.size, ev.time);
+    a2j_debug("input on %s: sucked %d bytes from inbound at %d", self->backend.jack->port_name (port->jack_port), ev.size, ev.time);
+  }
+
+  jack_ringbuffer_read_advance (port->inbound_events, consumed);
+  port->inbound_seen = visible - consumed;
+}
+
+/* ports are created and published by the main loop only, hand it the address */
+static
+void
+a2j_queue_port_update(
+  struct a2j * self,
+  snd_seq_addr_t addr)
+{
+  if (jack_ringbuffer_write_space(self->port_add) >= sizeof(addr)) {
+    a2j_debug("port_event: add/change %d:%d", addr.client, addr.port);
+    jack_ringbuffer_write(self->port_add, (char*)&addr, sizeof(addr));
+  } else {
+    A2J_STAT_INC (self->stats.port_events_dropped);
+    a2j_error("dropping port_event: add/change %d:%d", addr.client, addr.port);
   }
 }
 
@@ -135,17 +243,186 @@ a2j_port_event(
     return;
 
   if (ev->type == SND_SEQ_EVENT_PORT_START || ev->type == SND_SEQ_EVENT_PORT_CHANGE) {
-    if (jack_ringbuffer_write_space(self->port_add) >= sizeof(addr)) {
-      a2j_debug("port_event: add/change %d:%d", addr.client, addr.port);
-      jack_ringbuffer_write(self->port_add, (char*)&addr, sizeof(addr));
-    } else {
-      a2j_error("dropping port_event: add/change %d:%d", addr.client, addr.port);
-    }
+    a2j_queue_port_update(self, addr);
   } else if (ev->type == SND_SEQ_EVENT_PORT_EXIT) {
     a2j_debug("port_event: del %d:%d", addr.client, addr.port);
-    a2j_port_setdead(self->stream[A2J_PORT_CAPTURE].port_hash, addr);
-    a2j_port_setdead(self->stream[A2J_PORT_PLAYBACK].port_hash, addr);
+    a2j_port_setdead(self->stream[A2J_PORT_CAPTURE].port_table, addr);
+    a2j_port_setdead(self->stream[A2J_PORT_PLAYBACK].port_table, addr);
+  }
+}
+
+/* correlate ALSA queue real time with JACK time, at most every A2J_CLOCK_SAMPLE_USECS */
+static
+void
+a2j_input_clock_sample(
+  struct a2j * self)
+{
+  jack_time_t before;
+  jack_time_t after;
+  snd_seq_real_time_t rtime;
+
+  before = self->backend.jack->get_time ();
+  if (self->input_clock.valid && before - self->input_clock_sampled < A2J_CLOCK_SAMPLE_USECS) {
+    return;
+  }
+
+  if (self->backend.seq->get_queue_real_time (self->seq, self->queue, &rtime) < 0) {
+    return;
+  }
+
+  after = self->backend.jack->get_time ();
+  if (after - before > A2J_CLOCK_SAMPLE_MAX_USECS) {
+    /* preempted in between, the pair says little */
+    return;
+  }
+
+  a2j_clock_dll_update (
+    &self->input_clock,
+    (int64_t)rtime.tv_sec * 1000000 + rtime.tv_nsec / 1000,
+    (int64_t)(before + after) / 2);
+  self->input_clock_sampled = before;
+}
+
+/* jack_get_cycle_times() may only be called from the process callback, other threads get a copy */
+static
+void
+a2j_cycle_times_publish(
+  struct a2j * self,
+  jack_nframes_t nframes)
+{
+  struct a2j_cycle_times * times_ptr;
+  jack_nframes_t frames;
+  jack_time_t current_usecs;
+  jack_time_t next_usecs;
+  float period_usecs;
+  unsigned int seq;
+
+  if (self->backend.jack->get_cycle_times (self->jack_client, &frames, &current_usecs, &next_usecs, &period_usecs) != 0) {
+    return;
+  }
+
+  times_ptr = &self->cycle_times;
+  seq = times_ptr->seq;
+  __atomic_store_n (&times_ptr->seq, seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence (__ATOMIC_RELEASE);
+  __atomic_store_n (&times_ptr->frames, frames, __ATOMIC_RELAXED);
+  __atomic_store_n (&times_ptr->nframes, nframes, __ATOMIC_RELAXED);
+  __atomic_store_n (&times_ptr->current_usecs, current_usecs, __ATOMIC_RELAXED);
+  __atomic_store_n (&times_ptr->next_usecs, next_usecs, __ATOMIC_RELAXED);
+  __atomic_store_n (&times_ptr->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+static
+bool
+a2j_cycle_times_read(
+  const struct a2j_cycle_times * times_ptr,
+  struct a2j_cycle_times * copy_ptr)
+{
+  unsigned int seq;
+
+  do {
+    seq = __atomic_load_n (&times_ptr->seq, __ATOMIC_ACQUIRE);
+    if (seq == 0) {
+      return false;
+    }
+
+    copy_ptr->frames = __atomic_load_n (&times_ptr->frames, __ATOMIC_RELAXED);
+    copy_ptr->nframes = __atomic_load_n (&times_ptr->nframes, __ATOMIC_RELAXED);
+    copy_ptr->current_usecs = __atomic_load_n (&times_ptr->current_usecs, __ATOMIC_RELAXED);
+    copy_ptr->next_usecs = __atomic_load_n (&times_ptr->next_usecs, __ATOMIC_RELAXED);
+    __atomic_thread_fence (__ATOMIC_ACQUIRE);
+  } while ((seq & 1) != 0 || seq != __atomic_load_n (&times_ptr->seq, __ATOMIC_RELAXED));
+
+  return true;
+}
+
+/* JACK frame an input event arrived at, from its queue timestamp when it has one */
+static
+jack_nframes_t
+a2j_input_event_frame(
+  struct a2j * self,
+  const snd_seq_event_t * alsa_event)
+{
+  jack_nframes_t now;
+  jack_nframes_t frame;
+  struct a2j_cycle_times times;
+  int64_t usecs;
+
+  now = self->backend.jack->frame_time (self->jack_client);
+
+  if (!self->input_clock.valid ||
+      alsa_event->queue != self->queue ||
+      (alsa_event->flags & SND_SEQ_TIME_STAMP_MASK) != SND_SEQ_TIME_STAMP_REAL) {
+    return now;
+  }
+
+  if (!a2j_cycle_times_read (&self->cycle_times, &times) ||
+      times.next_usecs <= times.current_usecs) {
+    return now;
+  }
+
+  usecs = a2j_clock_dll_map (
+    &self->input_clock,
+    (int64_t)alsa_event->time.time.tv_sec * 1000000 + alsa_event->time.time.tv_nsec / 1000);
+
+  frame = times.frames + (jack_nframes_t)((usecs - (int64_t)times.current_usecs) * times.nframes / (int64_t)(times.next_usecs - times.current_usecs));
+
+  /* the loop may be a little ahead, nothing can have arrived later than now */
+  if (a2j_frames_before (now, frame)) {
+    return now;
+  }
+
+  return frame;
+}
+
+/* collect SysEx split over several sequencer events in a pooled buffer, return it once complete */
+static
+struct a2j_sysex_buffer *
+a2j_sysex_collect(
+  struct a2j * self,
+  struct a2j_port * port,
+  const jack_midi_data_t * chunk,
+  size_t len)
+{
+  struct a2j_sysex_buffer * sysex_ptr;
+
+  if (chunk[0] == 0xF0) {
+    if (port->sysex_assembly != NULL) {
+      /* previous message was never terminated, reuse its buffer */
+      A2J_STAT_INC (port->stats.dropped_sysex);
+      port->sysex_assembly->size = 0;
+    } else {
+      port->sysex_assembly = a2j_sysex_get (&self->sysex_pool);
+      if (port->sysex_assembly == NULL) {
+        A2J_STAT_INC (port->stats.dropped_sysex);
+        a2j_error ("MIDI data lost (no free SysEx buffer) on %s", port->name);
+        return NULL;
+      }
+    }
+  } else if (port->sysex_assembly == NULL) {
+    /* rest of a message that was dropped */
+    return NULL;
+  }
+
+  sysex_ptr = port->sysex_assembly;
+
+  if (sysex_ptr->size + len > self->sysex_pool.capacity) {
+    A2J_STAT_INC (port->stats.dropped_sysex);
+    a2j_error ("MIDI data lost (SysEx larger than %zu bytes) on %s", self->sysex_pool.capacity, port->name);
+    port->sysex_assembly = NULL;
+    a2j_sysex_put (&self->sysex_pool, sysex_ptr);
+    return NULL;
+  }
+
+  memcpy (sysex_ptr->data + sysex_ptr->size, chunk, len);
+  sysex_ptr->size += len;
+
+  if (chunk[len - 1] != 0xF7) {
+    return NULL;
   }
+
+  port->sysex_assembly = NULL;
+  return sysex_ptr;
 }
 
 static
@@ -159,71 +436,94 @@ a2j_input_event(
   long size;
   struct a2j_port *port;
   jack_nframes_t now;
+  const jack_midi_data_t * chunk;
+  size_t chunk_len;
+  struct a2j_alsa_midi_event ev;
+  size_t to_write;
+  jack_ringbuffer_data_t vec[2];
 
-  now = jack_frame_time (self->jack_client);
-  
-  if ((port = a2j_port_get(str->port_hash, alsa_event->source)) == NULL) {
+  if ((port = a2j_port_get(str->port_table, alsa_event->source)) == NULL) {
     return;
   }
 
-  /*
-   * RPNs, NRPNs, Bank Change, etc. need special handling
-   * but seems, ALSA does it for us already.
-   */
-  snd_midi_event_reset_decode(str->codec);
-  if ((size = snd_midi_event_decode(str->codec, data, sizeof(data), alsa_event))<0) {
-    return;
+  now = a2j_input_event_frame (self, alsa_event);
+
+  /* a port buffer takes events in time order only. a timestamped event
+     can map before an untimed one queued just ahead of it, and clock loop
+     updates can move the mapping back by a frame */
+  if (port->inbound_last_valid && a2j_frames_before (now, port->inbound_last_frame)) {
+    now = port->inbound_last_frame;
+  }
+  port->inbound_last_frame = now;
+  port->inbound_last_valid = true;
+
+  ev.sysex = NULL;
+
+  if (alsa_event->type == SND_SEQ_EVENT_SYSEX) {
+    chunk = alsa_event->data.ext.ptr;
+    chunk_len = alsa_event->data.ext.len;
+    if (chunk_len == 0) {
+      return;
+    }
+
+    /* anything but a complete message that fits in data goes through a pooled buffer */
+    if (port->sysex_assembly != NULL || chunk[0] != 0xF0 || chunk[chunk_len - 1] != 0xF7 || chunk_len > sizeof(data)) {
+      ev.sysex = a2j_sysex_collect (self, port, chunk, chunk_len);
+      if (ev.sysex == NULL) {
+        return;
+      }
+    }
   }
 
-  // fixup NoteOn with vel 0
-  if ((data[0] & 0xF0) == 0x90 && data[2] == 0x00) {
-    data[0] = 0x80 + (data[0] & 0x0F);
-    data[2] = 0x40;
+  if (ev.sysex != NULL) {
+    size = ev.sysex->size;
+    to_write = sizeof(ev);
+  } else {
+    /*
+     * RPNs, NRPNs, Bank Change, etc. need special handling
+     * but seems, ALSA does it for us already.
+     */
+    size = a2j_midi_decode_fast(alsa_event, data, sizeof(data));
+    if (size == 0) {
+      /* only for the few events the fast path leaves to it, the reset makes sure the event starts with its status byte */
+      snd_midi_event_reset_decode(port->codec);
+      if ((size = snd_midi_event_decode(port->codec, data, sizeof(data), alsa_event))<0) {
+        A2J_STAT_INC (port->stats.codec_errors);
+        return;
+      }
+    }
+
+    // fixup NoteOn with vel 0
+    if ((data[0] & 0xF0) == 0x90 && data[2] == 0x00) {
+      data[0] = 0x80 + (data[0] & 0x0F);
+      data[2] = 0x40;
+    }
+
+    to_write = sizeof(ev) + size;
   }
 
   a2j_debug("input: %d bytes at event_frame=%u", (int)size, now);
 
-  if (jack_ringbuffer_write_space(port->inbound_events) >= (sizeof(struct a2j_alsa_midi_event) + size)) {
-    struct a2j_alsa_midi_event ev;
-    char *ev_charp = (char*) &ev;
-    size_t limit;
-    size_t to_write = sizeof(ev);
+  if (self->trace != NULL) {
+    a2j_trace_record (self->trace, A2J_TRACE_INPUT_THREAD, A2J_TRACE_INPUT, now, &port->remote, ev.sysex != NULL ? ev.sysex->data : data, size);
+  }
 
-    jack_ringbuffer_data_t vec[2];
-    jack_ringbuffer_get_write_vector( port->inbound_events, vec );
+  if (jack_ringbuffer_write_space(port->inbound_events) >= to_write) {
     ev.time = now;
     ev.size = size;
 
-    
-    limit = (to_write > vec[0].len ? vec[0].len : to_write);
-    if( limit ) {
-        memcpy( vec[0].buf, ev_charp, limit );
-        to_write -= limit;
-        ev_charp += limit;
-        vec[0].buf += limit;
-        vec[0].len -= limit;
-    }
-    if( to_write ) {
-        memcpy( vec[1].buf, ev_charp, to_write );
-        vec[1].buf += to_write;
-        vec[1].len -= to_write;
-    }
-
-    to_write = size;
-    ev_charp = (char *)data;
-    limit = (to_write > vec[0].len ? vec[0].len : to_write);
-    if( limit )
-        memcpy( vec[0].buf, ev_charp, limit );
-    to_write -= limit;
-    ev_charp += limit;
-    if( to_write )
-        memcpy( vec[1].buf, ev_charp, to_write );
-
-    jack_ringbuffer_write_advance( port->inbound_events, sizeof(ev) + size );
+    jack_ringbuffer_get_write_vector( port->inbound_events, vec );
+    a2j_write_vector_copy( vec, &ev, sizeof(ev) );
+    if (ev.sysex == NULL)
+      a2j_write_vector_copy( vec, data, size );
+    jack_ringbuffer_write_advance( port->inbound_events, to_write );
+    a2j_stat_high_water (&port->stats.ring_high_water, jack_ringbuffer_read_space (port->inbound_events));
   } else {
+    A2J_STAT_INC (port->stats.dropped_ring_full);
+    if (ev.sysex != NULL)
+      a2j_sysex_put (&self->sysex_pool, ev.sysex);
     a2j_error ("MIDI data lost (incoming event buffer full): %ld bytes lost", size);
   }
-
 }
 
 /*
@@ -233,265 +533,732 @@ a2j_input_event(
 int
 a2j_process_outgoing (
   struct a2j * self,
-  struct a2j_port * port)
+  struct a2j_port * port,
+  jack_nframes_t * first_ptr)
 {
   /* collect data from JACK port buffer and queue it for later delivery by ALSA output thread */
 
   int nevents;
-  jack_ringbuffer_data_t vec[2];
   int i;
   int written = 0;
-  size_t limit;
-  struct a2j_delivery_event* dev;
-  size_t gap = 0;
+  jack_midi_event_t jack_event;
+  struct a2j_delivery_event dev;
+  size_t inline_size;
+  jack_ringbuffer_data_t vec[2];
 
-  jack_ringbuffer_get_write_vector (self->outbound_events, vec);
+  nevents = self->backend.jack->midi_get_event_count (port->jack_buf);
 
-  dev = (struct a2j_delivery_event*) vec[0].buf;
-  limit = vec[0].len / sizeof (struct a2j_delivery_event);
-  nevents = jack_midi_get_event_count (port->jack_buf);
+  /* events of one port are time ordered, the output thread merges the per-port queues */
+  for (i = 0; i < nevents; ++i) {
 
-  for (i = 0; (i < nevents) && (written < limit); ++i) {
+    self->backend.jack->midi_event_get (&jack_event, port->jack_buf, i);
+    if (jack_event.size == 0)
+      continue;
 
-    jack_midi_event_get (&dev->jack_event, port->jack_buf, i);
-    if (dev->jack_event.size <= MAX_JACKMIDI_EV_SIZE)
-    {
-      dev->time = dev->jack_event.time;
-      dev->port = port;
-      memcpy( dev->midistring, dev->jack_event.buffer, dev->jack_event.size );
-      written++;
-      ++dev;
+    if (jack_event.size > g_a2j_max_event_size) {
+      A2J_STAT_INC (port->stats.dropped_too_large);
+      continue;
     }
-  }
 
-  /* anything left? use the second part of the vector, as much as possible */
+    /* large SysEx goes in a pooled buffer, the port ring is sized for common messages */
+    inline_size = jack_event.size > MAX_EVENT_SIZE ? 0 : jack_event.size;
 
-  if (i < nevents)
-  {
-    if (vec[0].len)
-    {
-        gap = vec[0].len - written * sizeof(struct a2j_delivery_event);
+    if (jack_ringbuffer_write_space (port->outbound_events) < sizeof (dev) + inline_size) {
+      A2J_STAT_ADD (port->stats.dropped_ring_full, nevents - i);
+      break;
     }
 
-    dev = (struct a2j_delivery_event*) vec[1].buf;
-
-    limit += (vec[1].len / sizeof (struct a2j_delivery_event));
+    dev.sysex = NULL;
+    if (inline_size == 0) {
+      dev.sysex = a2j_sysex_get (&self->sysex_out_pool);
+      if (dev.sysex == NULL) {
+        A2J_STAT_INC (port->stats.dropped_sysex);
+        continue;
+      }
 
-    while ((i < nevents) && (written < limit))
-    {
-      jack_midi_event_get(&dev->jack_event, port->jack_buf, i);
-      if (dev->jack_event.size <= MAX_JACKMIDI_EV_SIZE)
-      {
-        dev->time = dev->jack_event.time;
-        dev->port = port;
-        memcpy(dev->midistring, dev->jack_event.buffer, dev->jack_event.size);
-        written++;
-        ++dev;
-      } 
-      ++i;
+      memcpy (dev.sysex->data, jack_event.buffer, jack_event.size);
+      dev.sysex->size = jack_event.size;
     }
-  }
 
-  a2j_debug( "done pushing events: %d ... gap: %d ", (int)written, (int)gap );
-  /* clear JACK port buffer; advance ring buffer ptr */
+    /* absolute, so it does not depend on the cycle the output thread sends it in */
+    dev.time = self->cycle_start + jack_event.time + self->output_delay;
+    dev.size = jack_event.size;
+    dev.port = port;
 
-  jack_ringbuffer_write_advance (self->outbound_events, written * sizeof (struct a2j_delivery_event) + gap);
+    /* header and data become visible to the output thread together */
+    jack_ringbuffer_get_write_vector (port->outbound_events, vec);
+    a2j_write_vector_copy (vec, &dev, sizeof (dev));
+    a2j_write_vector_copy (vec, jack_event.buffer, inline_size);
+    jack_ringbuffer_write_advance (port->outbound_events, sizeof (dev) + inline_size);
 
-  return nevents;
-}
+    if (self->trace != NULL)
+      a2j_trace_record (self->trace, A2J_TRACE_PROCESS_THREAD, A2J_TRACE_OUTPUT, self->cycle_start + jack_event.time, &port->remote, jack_event.buffer, jack_event.size);
 
-static int
-time_sorter (struct a2j_delivery_event * a, struct a2j_delivery_event * b)
-{
-  if (a->time < b->time) {
-    return -1;
-  } else if (a->time > b->time) {
-    return 1;
-  } 
-  return 0;
+    if (written++ == 0)
+      *first_ptr = dev.time;
+  }
+
+  if (written > 0)
+    a2j_stat_high_water (&port->stats.ring_high_water, jack_ringbuffer_read_space (port->outbound_events));
+
+  a2j_debug( "done pushing events: %d", written );
+
+  return written;
 }
 
-void * a2j_alsa_output_thread(void * arg)
+static
+struct a2j_port_array *
+a2j_acquire_ports(
+  struct a2j_stream * stream_ptr,
+  struct a2j_port_array ** seen_ptr)
 {
-  struct a2j * self = (struct a2j*) arg;
-  struct a2j_stream *str = &self->stream[A2J_PORT_PLAYBACK];
-  int i;
-  struct list_head evlist;
-  struct list_head * node_ptr;
-  jack_ringbuffer_data_t vec[2];
-  snd_seq_event_t alsa_event;
-  struct a2j_delivery_event* ev;
-  float sr;
-  jack_nframes_t now;
-  int err;
-  int limit;
-
-  while (g_keep_alsa_walking) {
-    /* first, make a list of all events in the outbound_events FIFO */
+  struct a2j_port_array * ports_ptr;
 
-    INIT_LIST_HEAD(&evlist);
+  /* pick up the array published by the main loop and let it know that older ones are no longer used */
+  ports_ptr = __atomic_load_n(&stream_ptr->active_ports, __ATOMIC_ACQUIRE);
+  __atomic_store_n(seen_ptr, ports_ptr, __ATOMIC_RELEASE);
 
-    jack_ringbuffer_get_read_vector (self->outbound_events, vec);
+  return ports_ptr;
+}
 
-    a2j_debug ("output thread: got %d+%d events", 
-               (vec[0].len / sizeof (struct a2j_delivery_event)),
-               (vec[1].len / sizeof (struct a2j_delivery_event)));
-    
-    ev = (struct a2j_delivery_event*) vec[0].buf;
-    limit = vec[0].len / sizeof (struct a2j_delivery_event);
-    for (i = 0; i < limit; ++i) {
-      list_add_tail(&ev->siblings, &evlist);
-      ev++;
-    }
+/* binary min-heap of the head events of playback ports, keyed by absolute frame time */
 
-    ev = (struct a2j_delivery_event*) vec[1].buf;
-    limit = vec[1].len / sizeof (struct a2j_delivery_event);
-    for (i = 0; i < limit; ++i) {
-      list_add_tail(&ev->siblings, &evlist);
-      ev++;
-    }
+static
+void
+a2j_delivery_heap_sift_down(
+  struct a2j_delivery_event * heap,
+  unsigned int count,
+  unsigned int i)
+{
+  struct a2j_delivery_event tmp;
+  unsigned int child;
 
-    if (vec[0].len < sizeof(struct a2j_delivery_event) && (vec[1].len == 0)) {
-      /* no events: wait for some */
-      a2j_debug ("output thread: wait for events");
-      sem_wait (&self->io_semaphore);
-      a2j_debug ("output thread: AWAKE ... loop back for events");
-      continue;
-    }
+  while ((child = 2 * i + 1) < count) {
+    if (child + 1 < count && a2j_frames_before(heap[child + 1].time, heap[child].time))
+      child++;
+    if (!a2j_frames_before(heap[child].time, heap[i].time))
+      break;
+    tmp = heap[i];
+    heap[i] = heap[child];
+    heap[child] = tmp;
+    i = child;
+  }
+}
 
-    /* now sort this list by time */
+static
+void
+a2j_delivery_heap_sift_up(
+  struct a2j_delivery_event * heap,
+  unsigned int i)
+{
+  struct a2j_delivery_event tmp;
+  unsigned int parent;
 
-    list_sort(&evlist, struct a2j_delivery_event, siblings, time_sorter);
+  while (i > 0) {
+    parent = (i - 1) / 2;
+    if (!a2j_frames_before(heap[i].time, heap[parent].time))
+      break;
+    tmp = heap[i];
+    heap[i] = heap[parent];
+    heap[parent] = tmp;
+    i = parent;
+  }
+}
 
-    /* now deliver */
+/* the sequencer has no room for our events, wait a bit for it to deliver some */
+static
+void
+a2j_wait_output_room(
+  struct a2j * self)
+{
+  struct pollfd pfd;
 
-    sr = jack_get_sample_rate (self->jack_client);
+  if (self->backend.seq->poll_descriptors (self->seq, &pfd, 1, POLLOUT) == 1) {
+    poll (&pfd, 1, 100);
+  }
+}
 
-    list_for_each(node_ptr, &evlist)
-    {
-      ev = list_entry(node_ptr, struct a2j_delivery_event, siblings);
+/* write everything buffered by snd_seq_event_output() to the sequencer with one syscall */
+static
+void
+a2j_drain_output(
+  struct a2j * self)
+{
+  int err;
 
-      snd_seq_ev_clear(&alsa_event);
-      snd_midi_event_reset_encode(str->codec);
-      if (!snd_midi_event_encode(str->codec, (const unsigned char *)ev->midistring, ev->jack_event.size, &alsa_event))
-      {
-        continue; // invalid event
-      }
-      
-      snd_seq_ev_set_source(&alsa_event, self->port_id);
-      snd_seq_ev_set_dest(&alsa_event, ev->port->remote.client, ev->port->remote.port);
-      snd_seq_ev_set_direct (&alsa_event);
-      
-      now = jack_frame_time (self->jack_client);
-
-      ev->time += self->cycle_start;
-
-      a2j_debug ("@ %d, next event @ %d", now, ev->time);
-      
-      /* do we need to wait a while before delivering? */
-
-      if (ev->time > now) {
-        struct timespec nanoseconds;
-        jack_nframes_t sleep_frames = ev->time - now;
-        float seconds = sleep_frames / sr;
-
-        /* if the gap is long enough, sleep */
-
-        if (seconds > 0.001) {
-          nanoseconds.tv_sec = (time_t) seconds;
-          nanoseconds.tv_nsec = (long) NSEC_PER_SEC * (seconds - nanoseconds.tv_sec);
-          
-          a2j_debug ("output thread sleeps for %.2f msec", ((double) nanoseconds.tv_nsec / NSEC_PER_SEC) * 1000.0);
-
-          if (nanosleep (&nanoseconds, NULL) < 0) {
-            fprintf (stderr, "BAD SLEEP\n");
-            /* do something ? */
-          }
-        }
-      }
-      
-      /* its time to deliver */
-      err = snd_seq_event_output(self->seq, &alsa_event);
-      snd_seq_drain_output (self->seq);
-      now = jack_frame_time (self->jack_client);
-      a2j_debug("alsa_out: written %d bytes to %s at %d, DELTA = %d", ev->jack_event.size, ev->port->name, now, 
-                (int32_t) (now - ev->time));
+  while ((err = self->backend.seq->drain_output (self->seq)) != 0 && g_keep_alsa_walking) {
+    if (err < 0 && err != -EAGAIN) {
+      A2J_STAT_INC (self->stats.drain_errors);
+      a2j_error ("failed to drain output events: %s", snd_strerror (err));
+      return;
     }
 
-    /* free up space in the FIFO */
-    
-    jack_ringbuffer_read_advance (self->outbound_events, vec[0].len + vec[1].len);
+    a2j_wait_output_room (self);
+  }
+}
 
-    /* and head back for more */
+/* buffer an event for a2j_drain_output(), waiting for room rather than dropping it */
+static
+void
+a2j_event_output(
+  struct a2j * self,
+  snd_seq_event_t * alsa_event,
+  struct a2j_port * port_ptr)
+{
+  int err;
+
+  while ((err = self->backend.seq->event_output (self->seq, alsa_event)) == -EAGAIN && g_keep_alsa_walking) {
+    a2j_wait_output_room (self);
   }
 
-  return (void*) 0;
+  if (err < 0) {
+    A2J_STAT_INC (port_ptr->stats.output_errors);
+    a2j_error ("failed to output event for %s: %s", port_ptr->name, snd_strerror (err));
+  }
 }
 
-#define a2j_ptr ((struct a2j *)arg)
-
-/* ALSA */
+/* events due closer than this are delivered right away, together with the rest of the batch */
+#define A2J_OUTPUT_WINDOW_USECS 50
 
-void * a2j_alsa_input_thread(void * arg)
+static
+inline
+int64_t
+a2j_monotonic_nsec(void)
 {
-  struct a2j * self = arg;
-  int npfd;
-  struct pollfd * pfd;
-  snd_seq_addr_t addr;
-  snd_seq_client_info_t * client_info;
-  snd_seq_port_info_t * port_info;
-  bool initial;
-  snd_seq_event_t * event;
-  int ret;
+  struct timespec ts;
 
-  npfd = snd_seq_poll_descriptors_count(self->seq, POLLIN);
-  pfd = (struct pollfd *)alloca(npfd * sizeof(struct pollfd));
-  snd_seq_poll_descriptors(self->seq, pfd, npfd, POLLIN);
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
 
-  initial = true;
-  while (g_keep_alsa_walking)
-  {
-    if ((ret = poll(pfd, npfd, 1000)) > 0)
-    {
+static
+void
+a2j_spin_until(
+  int64_t deadline)
+{
+  while (a2j_monotonic_nsec () < deadline)
+    ;
+}
 
-      while (snd_seq_event_input (self->seq, &event) > 0)
-      {
-        if (initial)
-        {
-          snd_seq_client_info_alloca(&client_info);
-          snd_seq_port_info_alloca(&port_info);
-          snd_seq_client_info_set_client(client_info, -1);
-          while (snd_seq_query_next_client(self->seq, client_info) >= 0)
-          {
-            addr.client = snd_seq_client_info_get_client(client_info);
-            if (addr.client == SND_SEQ_CLIENT_SYSTEM || addr.client == self->client_id)
-              continue;
-            snd_seq_port_info_set_client(port_info, addr.client);
-            snd_seq_port_info_set_port(port_info, -1);
-            while (snd_seq_query_next_port(self->seq, port_info) >= 0)
-            {
-              addr.port = snd_seq_port_info_get_port(port_info);
-              a2j_update_port(self, addr, port_info);
-            }
-          }
+/* schedule event on our queue at the time JACK frame due maps to, relative to a queue time sample */
+static
+void
+a2j_schedule_on_queue(
+  struct a2j * self,
+  snd_seq_event_t * alsa_event,
+  jack_nframes_t due,
+  const snd_seq_real_time_t * queue_now,
+  jack_time_t usecs_now)
+{
+  snd_seq_real_time_t rtime;
+  int64_t delay;
+  int64_t nsec;
 
-          initial = false;
-        }
+  delay = (int64_t)(self->backend.jack->frames_to_time(self->jack_client, due) - usecs_now);
+  if (delay < 0) {
+    delay = 0;
+  }
 
-        if (event->source.client == SND_SEQ_CLIENT_SYSTEM)
-        {
-          a2j_port_event(a2j_ptr, event);
+  nsec = (int64_t)queue_now->tv_nsec + delay * 1000;
+  rtime.tv_sec = queue_now->tv_sec + nsec / NSEC_PER_SEC;
+  rtime.tv_nsec = nsec % NSEC_PER_SEC;
+
+  snd_seq_ev_schedule_real(alsa_event, self->queue, 0, &rtime);
+}
+
+/* drop the heap events of dead ports, they may be freed once we acknowledge a port array without them */
+static
+unsigned int
+a2j_delivery_heap_purge(
+  struct a2j * self,
+  struct a2j_delivery_event * heap,
+  unsigned int count)
+{
+  unsigned int i;
+  unsigned int kept;
+
+  kept = 0;
+  for (i = 0; i < count; i++) {
+    if (heap[i].port->is_dead) {
+      heap[i].port->out_queued = false;
+      if (heap[i].sysex != NULL)
+        a2j_sysex_put (&self->sysex_out_pool, heap[i].sysex);
+      continue;
+    }
+    heap[kept++] = heap[i];
+  }
+
+  if (kept != count) {
+    for (i = kept / 2; i-- > 0; )
+      a2j_delivery_heap_sift_down (heap, kept, i);
+  }
+
+  return kept;
+}
+
+/* take the head event of every playback port that has one queued and is not in the heap yet */
+static
+unsigned int
+a2j_delivery_heap_fill(
+  struct a2j_port_array * ports_ptr,
+  struct a2j_delivery_event * heap,
+  unsigned int * count_ptr,
+  unsigned int size)
+{
+  unsigned int i;
+  unsigned int added;
+  struct a2j_port * port_ptr;
+
+  added = 0;
+  for (i = 0; ports_ptr != NULL && i < ports_ptr->count && *count_ptr < size; i++) {
+    port_ptr = ports_ptr->ports[i];
+
+    if (port_ptr->out_queued || port_ptr->is_dead)
+      continue;
+
+    if (jack_ringbuffer_read_space (port_ptr->outbound_events) < sizeof (struct a2j_delivery_event))
+      continue;
+
+    jack_ringbuffer_read (port_ptr->outbound_events, (char *)&heap[*count_ptr], sizeof (struct a2j_delivery_event));
+    port_ptr->out_queued = true;
+    a2j_delivery_heap_sift_up (heap, (*count_ptr)++);
+    added++;
+  }
+
+  return added;
+}
+
+void
+a2j_wake_output_thread(
+  struct a2j * self)
+{
+  uint64_t one = 1;
+  ssize_t ret;
+
+  /* eventfd is non-blocking and the counter cannot realistically overflow, nothing to handle */
+  ret = write (self->io_eventfd, &one, sizeof (one));
+  (void) ret;
+}
+
+void * a2j_alsa_output_thread(void * arg)
+{
+  struct a2j * self = (struct a2j*) arg;
+  struct a2j_stream *str = &self->stream[A2J_PORT_PLAYBACK];
+  struct a2j_port_array * ports_ptr;
+  struct a2j_port_array * seen_ports = NULL;
+  struct a2j_port * port_ptr;
+  struct a2j_delivery_event * heap = NULL;
+  struct a2j_delivery_event * new_heap;
+  unsigned int heap_size = 0;
+  unsigned int heap_count = 0;
+  snd_seq_event_t alsa_event;
+  struct a2j_delivery_event* ev;
+  unsigned char buffer[MAX_EVENT_SIZE];
+  const unsigned char * data;
+  uint32_t pos;
+  long consumed;
+  snd_seq_real_time_t queue_now = {0, 0};
+  jack_time_t queue_usecs = 0;
+  bool queue_sampled = false;
+  jack_time_t usecs_now;
+  int64_t offset;
+  int64_t deadline;
+  int64_t remaining;
+  int64_t lateness;
+  struct pollfd pfd[2];
+  struct itimerspec timer;
+  uint64_t counter;
+  ssize_t ret;
+
+  if (g_a2j_lock_memory) {
+    a2j_prefault_stack ();
+  }
+
+  pfd[0].fd = self->io_eventfd;
+  pfd[0].events = POLLIN;
+  pfd[1].fd = self->io_timerfd;
+  pfd[1].events = POLLIN;
+  memset (&timer, 0, sizeof (timer));
+
+  while (g_keep_alsa_walking) {
+    ports_ptr = __atomic_load_n (&str->active_ports, __ATOMIC_ACQUIRE);
+    if (ports_ptr != seen_ports) {
+      /* ports missing from a new array are dead, forget their events before letting the main loop free them */
+      heap_count = a2j_delivery_heap_purge (self, heap, heap_count);
+      __atomic_store_n (&str->out_ports, ports_ptr, __ATOMIC_RELEASE);
+      seen_ports = ports_ptr;
+    }
+
+    if (ports_ptr != NULL && ports_ptr->count > heap_size) {
+      new_heap = realloc(heap, ports_ptr->count * sizeof(struct a2j_delivery_event));
+      if (new_heap == NULL) {
+        a2j_error ("output thread: cannot allocate merge heap for %u ports", ports_ptr->count);
+      } else {
+        if (g_a2j_lock_memory) {
+          memset (new_heap + heap_size, 0, (ports_ptr->count - heap_size) * sizeof(struct a2j_delivery_event));
+        }
+        heap = new_heap;
+        heap_size = ports_ptr->count;
+      }
+    }
+
+    /* the heap keeps the head event of every port with queued output, across wakeups */
+    a2j_delivery_heap_fill (ports_ptr, heap, &heap_count, heap_size);
+
+    a2j_debug ("output thread: %u ports have events", heap_count);
+
+    /* one sample of JACK and monotonic time for the batch; event deadlines are taken relative to it */
+    usecs_now = self->backend.jack->get_time ();
+
+    /* the queue time costs an ioctl, one sample per wakeup serves every pass until the next sleep */
+    if (g_a2j_kernel_scheduling && !queue_sampled && heap_count > 0) {
+      self->backend.seq->get_queue_real_time (self->seq, self->queue, &queue_now);
+      queue_usecs = self->backend.jack->get_time ();
+      queue_sampled = true;
+    }
+
+    offset = a2j_monotonic_nsec () - (int64_t)usecs_now * NSEC_PER_USEC;
+
+    /* deliver what is due, merging the time ordered port queues */
+    deadline = 0;
+    while (heap_count > 0)
+    {
+      ev = &heap[0];
+
+      if (!g_a2j_kernel_scheduling) {
+        deadline = (int64_t)self->backend.jack->frames_to_time (self->jack_client, ev->time) * NSEC_PER_USEC + offset;
+        remaining = deadline - a2j_monotonic_nsec ();
+
+        if (remaining > (A2J_OUTPUT_WINDOW_USECS + (int64_t)g_a2j_spin_usecs) * NSEC_PER_USEC) {
+          /* not due yet, sleep until it is */
+          break;
         }
-        else
+
+        if (remaining > A2J_OUTPUT_WINDOW_USECS * NSEC_PER_USEC) {
+          /* hand the events buffered so far to the sequencer, then busy wait for the rest */
+          a2j_drain_output (self);
+          a2j_spin_until (deadline);
+        }
+      }
+
+      if (ev->sysex != NULL) {
+        data = ev->sysex->data;
+      } else {
+        jack_ringbuffer_read (ev->port->outbound_events, (char *)buffer, ev->size);
+        data = buffer;
+      }
+
+      /* common messages are converted directly, keeping running status
+         in the port. the port encoder keeps its state from earlier events,
+         so SysEx may continue over several JACK events; it splits SysEx
+         larger than its buffer into several sequencer events */
+      snd_seq_ev_clear(&alsa_event);
+      for (pos = 0; pos < ev->size; pos += consumed) {
+        consumed = 0;
+        if (pos == 0) {
+          consumed = a2j_midi_encode_fast(&ev->port->out_running_status, data, ev->size, &alsa_event);
+          if (consumed > 0 && data[0] < 0xF8) {
+            /* a status the encoder did not see ends its SysEx and running status */
+            ev->port->out_encoder_stale = true;
+          }
+        }
+        if (consumed == 0) {
+          if (ev->port->out_encoder_stale) {
+            snd_midi_event_reset_encode(ev->port->codec);
+            ev->port->out_encoder_stale = false;
+          }
+          /* the encoder tracks running status from here on */
+          ev->port->out_running_status = 0;
+          consumed = snd_midi_event_encode(ev->port->codec, data + pos, ev->size - pos, &alsa_event);
+        }
+        if (consumed <= 0) {
+          A2J_STAT_INC (ev->port->stats.codec_errors);
+          snd_midi_event_reset_encode(ev->port->codec);
+          break; // invalid event
+        }
+
+        if (alsa_event.type == SND_SEQ_EVENT_NONE) {
+          continue;
+        }
+
+        snd_seq_ev_set_source(&alsa_event, self->port_id);
+        snd_seq_ev_set_dest(&alsa_event, ev->port->remote.client, ev->port->remote.port);
+        snd_seq_ev_set_direct (&alsa_event);
+
+        if (g_a2j_kernel_scheduling) {
+          /* the sequencer delivers it when due, the whole batch is drained below */
+          a2j_schedule_on_queue (self, &alsa_event, ev->time, &queue_now, queue_usecs);
+        }
+
+        /* its time to deliver; buffered, drained together with everything due in the same window */
+        a2j_event_output (self, &alsa_event, ev->port);
+        snd_seq_ev_clear(&alsa_event);
+      }
+
+      if (!g_a2j_kernel_scheduling) {
+        lateness = (a2j_monotonic_nsec () - deadline) / NSEC_PER_USEC;
+        a2j_histogram_add (&self->output_lateness, lateness);
+        a2j_histogram_add (&ev->port->latency, lateness);
+        a2j_debug ("alsa_out: written %u bytes to %s, DELTA = %lld usecs", ev->size, ev->port->name, (long long) lateness);
+      }
+
+      A2J_STAT_INC (ev->port->stats.events);
+      A2J_STAT_ADD (ev->port->stats.bytes, ev->size);
+
+      if (ev->sysex != NULL)
+        a2j_sysex_put (&self->sysex_out_pool, ev->sysex);
+
+      /* replace the delivered event with the next one from the same port */
+      port_ptr = ev->port;
+      if (jack_ringbuffer_read_space (port_ptr->outbound_events) >= sizeof (struct a2j_delivery_event)) {
+        jack_ringbuffer_read (port_ptr->outbound_events, (char *)&heap[0], sizeof (struct a2j_delivery_event));
+      } else {
+        port_ptr->out_queued = false;
+        heap[0] = heap[--heap_count];
+      }
+      a2j_delivery_heap_sift_down (heap, heap_count, 0);
+    }
+
+    a2j_drain_output (self);
+
+    /* tell jack process which events need to wake us, then look at the ports once more;
+       anything queued before it could see the new deadline is picked up here */
+    __atomic_store_n (&self->out_next_frame, heap_count > 0 ? heap[0].time : A2J_OUTPUT_IDLE, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence (__ATOMIC_SEQ_CST);
+    if (a2j_delivery_heap_fill (ports_ptr, heap, &heap_count, heap_size) > 0) {
+      continue;
+    }
+
+    /* sleep until the earliest deadline, an earlier event, a new port array or stop request */
+    if (heap_count > 0) {
+      deadline -= (int64_t)g_a2j_spin_usecs * NSEC_PER_USEC;
+      timer.it_value.tv_sec = deadline / NSEC_PER_SEC;
+      timer.it_value.tv_nsec = deadline % NSEC_PER_SEC;
+    } else {
+      timer.it_value.tv_sec = 0;
+      timer.it_value.tv_nsec = 0;
+    }
+
+    if (timerfd_settime (self->io_timerfd, TFD_TIMER_ABSTIME, &timer, NULL) < 0) {
+      a2j_error ("output thread: cannot arm timer: %s", strerror (errno));
+    }
+
+    a2j_debug ("output thread: wait for events");
+    if (poll (pfd, 2, -1) < 0 && errno != EINTR) {
+      a2j_error ("output thread: poll failed: %s", strerror (errno));
+    }
+    queue_sampled = false;
+
+    if (pfd[0].revents & POLLIN) {
+      ret = read (self->io_eventfd, &counter, sizeof (counter));
+      (void) ret;
+    }
+
+    if (pfd[1].revents & POLLIN) {
+      ret = read (self->io_timerfd, &counter, sizeof (counter));
+      (void) ret;
+    }
+
+    /* and head back for more */
+  }
+
+  if (!g_a2j_kernel_scheduling) {
+    a2j_histogram_log (&self->output_lateness, "Output lateness");
+  }
+
+  free (heap);
+
+  return (void*) 0;
+}
+
+/* ALSA */
+
+static
+void
+a2j_input_scan_ports(
+  struct a2j * self)
+{
+  snd_seq_addr_t addr;
+  snd_seq_client_info_t * client_info;
+  snd_seq_port_info_t * port_info;
+
+  snd_seq_client_info_alloca(&client_info);
+  snd_seq_port_info_alloca(&port_info);
+  snd_seq_client_info_set_client(client_info, -1);
+  while (self->backend.seq->query_next_client(self->seq, client_info) >= 0)
+  {
+    addr.client = snd_seq_client_info_get_client(client_info);
+    if (addr.client == SND_SEQ_CLIENT_SYSTEM || addr.client == self->client_id)
+      continue;
+    snd_seq_port_info_set_client(port_info, addr.client);
+    snd_seq_port_info_set_port(port_info, -1);
+    while (self->backend.seq->query_next_port(self->seq, port_info) >= 0)
+    {
+      addr.port = snd_seq_port_info_get_port(port_info);
+      a2j_queue_port_update(self, addr);
+    }
+  }
+}
+
+static
+void
+a2j_input_dispatch(
+  struct a2j * self,
+  snd_seq_event_t * event)
+{
+  if (event->source.client == SND_SEQ_CLIENT_SYSTEM)
+  {
+    a2j_port_event(self, event);
+  }
+  else
+  {
+    a2j_input_event(self, event);
+  }
+}
+
+/* read batches of events straight from the sequencer device and walk them
+   in place; variable length data follows its event, padded to whole events,
+   the same layout alsa-lib parses into its input buffer. returns events read */
+static
+unsigned long
+a2j_input_read_raw(
+  struct a2j * self,
+  int fd,
+  char * buf,
+  size_t size,
+  bool * initial_ptr)
+{
+  snd_seq_event_t * event;
+  ssize_t len;
+  size_t pos;
+  size_t cells;
+  unsigned long count;
+
+  count = 0;
+
+  while ((len = read(fd, buf, size)) > 0)
+  {
+    if (*initial_ptr)
+    {
+      a2j_input_scan_ports(self);
+      *initial_ptr = false;
+    }
+
+    for (pos = 0; pos + sizeof(snd_seq_event_t) <= (size_t)len; pos += cells * sizeof(snd_seq_event_t))
+    {
+      event = (snd_seq_event_t *)(buf + pos);
+      cells = 1;
+
+      if (snd_seq_ev_is_variable(event))
+      {
+        event->data.ext.ptr = event + 1;
+        cells += (event->data.ext.len + sizeof(snd_seq_event_t) - 1) / sizeof(snd_seq_event_t);
+      }
+
+      a2j_input_dispatch(self, event);
+      count++;
+    }
+  }
+
+  if (len < 0 && errno != EAGAIN && errno != EINTR)
+  {
+    a2j_error("ALSA input thread: read failed: %s", strerror(errno));
+  }
+
+  return count;
+}
+
+void * a2j_alsa_input_thread(void * arg)
+{
+  struct a2j * self = arg;
+  int npfd;
+  struct pollfd * pfd;
+  bool initial;
+  snd_seq_event_t * event;
+  char * raw_buf;
+  size_t raw_size;
+  unsigned long events;
+  double cpu_secs;
+  int ret;
+
+  if (g_a2j_lock_memory)
+  {
+    a2j_prefault_stack();
+  }
+
+  a2j_clock_dll_init(&self->input_clock);
+
+  npfd = self->backend.seq->poll_descriptors_count(self->seq, POLLIN);
+  pfd = (struct pollfd *)alloca(npfd * sizeof(struct pollfd));
+  self->backend.seq->poll_descriptors(self->seq, pfd, npfd, POLLIN);
+
+  /* the batch is as large as the alsa-lib input buffer, so every event that fits there fits here */
+  raw_buf = NULL;
+  raw_size = self->backend.seq->get_input_buffer_size(self->seq);
+  if (g_a2j_raw_input)
+  {
+    if (self->backend.seq->type(self->seq) != SND_SEQ_TYPE_HW)
+    {
+      a2j_warning("raw input needs a kernel sequencer client, reading events through alsa-lib");
+    }
+    else if ((raw_buf = malloc(raw_size)) == NULL)
+    {
+      a2j_error("cannot allocate %zu bytes raw input buffer, reading events through alsa-lib", raw_size);
+    }
+    else if (g_a2j_lock_memory)
+    {
+      memset(raw_buf, 0, raw_size);
+    }
+  }
+
+  events = 0;
+  initial = true;
+  while (g_keep_alsa_walking)
+  {
+    /* no port looked up before is used past this point, ports removed from the tables may be freed */
+    a2j_acquire_ports(&self->stream[A2J_PORT_CAPTURE], &self->stream[A2J_PORT_CAPTURE].in_ports);
+    a2j_acquire_ports(&self->stream[A2J_PORT_PLAYBACK], &self->stream[A2J_PORT_PLAYBACK].in_ports);
+
+    /* wake up at least as often as the clock is sampled, so an idle loop stays locked */
+    ret = poll(pfd, npfd, A2J_CLOCK_SAMPLE_USECS / 1000);
+
+    /* before the events are stamped, and when idle to keep the loop locked */
+    a2j_input_clock_sample(self);
+
+    if (ret > 0)
+    {
+      if (raw_buf != NULL)
+      {
+        events += a2j_input_read_raw(self, pfd[0].fd, raw_buf, raw_size, &initial);
+        continue;
+      }
+
+      while (self->backend.seq->event_input (self->seq, &event) > 0)
+      {
+        if (initial)
         {
-          a2j_input_event(a2j_ptr, event);
+          a2j_input_scan_ports(self);
+          initial = false;
         }
 
-        snd_seq_free_event (event);
+        a2j_input_dispatch(self, event);
+        events++;
+
+        self->backend.seq->free_event (self->seq, event);
       }
     }
   }
 
+  cpu_secs = a2j_thread_cpu_time();
+  a2j_info(
+    "ALSA input thread: %lu events (%s) in %.3f s of CPU time, %.0f events per CPU second",
+    events,
+    raw_buf != NULL ? "raw" : "alsa-lib",
+    cpu_secs,
+    cpu_secs > 0 ? events / cpu_secs : 0.0);
+
+  free(raw_buf);
+
   return (void*) 0;
 }
 
@@ -506,54 +1273,118 @@ a2j_jack_process_internal(
   jack_nframes_t nframes)
 {
   struct a2j_stream * stream_ptr;
-  int i;
-  struct a2j_port ** port_ptr_ptr;
+  struct a2j_port_array * ports_ptr;
+  unsigned int i;
   struct a2j_port * port_ptr;
   int nevents = 0;
+  int written;
+  jack_nframes_t first;
+  jack_nframes_t earliest = 0;
+  uint64_t next;
 
   stream_ptr = &self->stream[dir];
-  a2j_add_ports(stream_ptr);
+  ports_ptr = a2j_acquire_ports(stream_ptr, &stream_ptr->rt_ports);
+
+  if (ports_ptr == NULL)
+  {
+    return;
+  }
 
   // process ports
-  for (i = 0 ; i < PORT_HASH_SIZE ; i++)
+  for (i = 0 ; i < ports_ptr->count ; i++)
   {
-    port_ptr_ptr = &stream_ptr->port_hash[i];
-    while (*port_ptr_ptr != NULL)
+    port_ptr = ports_ptr->ports[i];
+
+    if (!port_ptr->is_dead)
     {
-      port_ptr = *port_ptr_ptr;
+      port_ptr->jack_buf = self->backend.jack->port_get_buffer(port_ptr->jack_port, nframes);
+
+      if (dir == A2J_PORT_CAPTURE) {
+        a2j_process_incoming (self, port_ptr, nframes);
+      } else {
+        written = a2j_process_outgoing (self, port_ptr, &first);
+        if (written > 0 && (nevents == 0 || a2j_frames_before(first, earliest)))
+          earliest = first;
+        nevents += written;
+      }
 
-      if (!port_ptr->is_dead)
-      {
-        port_ptr->jack_buf = jack_port_get_buffer(port_ptr->jack_port, nframes);
+    } else if (!port_ptr->is_released && jack_ringbuffer_write_space (self->port_del) >= sizeof(port_ptr)) {
 
-        if (dir == A2J_PORT_CAPTURE) {
-          a2j_process_incoming (self, port_ptr, nframes);
-        } else {
-          nevents += a2j_process_outgoing (self, port_ptr);
-        }
+      a2j_debug("jack: removed port %s", port_ptr->name);
+      a2j_port_remove(stream_ptr->port_table, port_ptr);
+      jack_ringbuffer_write(self->port_del, (char*)&port_ptr, sizeof(port_ptr));
+      port_ptr->is_released = true;
 
-      } else if (jack_ringbuffer_write_space (self->port_del) >= sizeof(port_ptr)) {
+    }
+  }
 
-        a2j_debug("jack: removed port %s", port_ptr->name);
-        *port_ptr_ptr = port_ptr->next;
-        jack_ringbuffer_write(self->port_del, (char*)&port_ptr, sizeof(port_ptr));
-        continue;
+  /* if we queued up anything for output, wake the output thread only
+     when it sleeps past the earliest of it. Pairs with the fence after
+     it publishes its deadline, one of us sees what the other did.
+  */
 
+  if (nevents > 0) {
+    __atomic_thread_fence (__ATOMIC_SEQ_CST);
+    next = __atomic_load_n (&self->out_next_frame, __ATOMIC_SEQ_CST);
+    if (next == A2J_OUTPUT_IDLE || a2j_frames_before(earliest, (jack_nframes_t)next)) {
+      a2j_wake_output_thread (self);
+    }
+  }
+}
+
+/* frames between ALSA arrival and JACK delivery for the cycle about to be processed */
+static
+void
+a2j_input_delay_update(
+  struct a2j * self,
+  jack_nframes_t nframes)
+{
+  int64_t delay;
+  int64_t margin;
+
+  if (!g_a2j_input_delay_adaptive)
+  {
+    delay = g_a2j_input_delay != 0 ? g_a2j_input_delay : nframes;
+  }
+  else
+  {
+    delay = self->input_delay;
+    margin = nframes / A2J_INPUT_DELAY_MARGIN_FRACTION;
+
+    /* an event came late or nearly so, grow right away */
+    if (self->input_age_max != INT32_MIN && self->input_age_max + margin > delay)
+    {
+      delay = self->input_age_max + margin;
+    }
+
+    /* shrink to what the events of the window needed */
+    if (++self->input_delay_cycles >= A2J_INPUT_DELAY_WINDOW_CYCLES)
+    {
+      if (self->input_age_max != INT32_MIN)
+      {
+        delay = (self->input_age_max > 0 ? self->input_age_max : 0) + margin;
       }
 
-      port_ptr_ptr = &port_ptr->next;
+      self->input_age_max = INT32_MIN;
+      self->input_delay_cycles = 0;
+    }
+
+    if (delay > (int64_t)nframes * A2J_INPUT_DELAY_MAX_PERIODS)
+    {
+      delay = (int64_t)nframes * A2J_INPUT_DELAY_MAX_PERIODS;
     }
   }
 
-  /* if we queued up anything for output, tell the output thread in 
-     case its waiting for us.
-  */
+  /* read by the main loop and the latency callback */
+  __atomic_store_n (&self->input_delay, (jack_nframes_t)delay, __ATOMIC_RELAXED);
+}
 
-  if (nevents > 0) {
-    int sv;
-    sem_getvalue (&self->io_semaphore, &sv);
-    sem_post (&self->io_semaphore);
-  } 
+static
+jack_nframes_t
+a2j_output_delay(
+  jack_nframes_t nframes)
+{
+  return g_a2j_output_delay_period ? nframes : g_a2j_output_delay;
 }
 
 static
@@ -565,9 +1396,23 @@ a2j_jack_process(
   struct a2j* self = (struct a2j *) arg;
 
   if (g_freewheeling)
+  {
+    /* not touching any port, but the main loop still waits for us to release old port arrays */
+    a2j_acquire_ports(&self->stream[A2J_PORT_CAPTURE], &self->stream[A2J_PORT_CAPTURE].rt_ports);
+    a2j_acquire_ports(&self->stream[A2J_PORT_PLAYBACK], &self->stream[A2J_PORT_PLAYBACK].rt_ports);
     return 0;
+  }
 
-  self->cycle_start = jack_last_frame_time (self->jack_client);
+  self->cycle_start = self->backend.jack->last_frame_time (self->jack_client);
+  a2j_cycle_times_publish (self, nframes);
+  a2j_input_delay_update (self, nframes);
+
+  if (self->trace != NULL)
+  {
+    a2j_trace_cycle (self->trace, self->cycle_start, nframes, self->input_delay);
+  }
+
+  __atomic_store_n (&self->output_delay, a2j_output_delay (nframes), __ATOMIC_RELAXED);
 
   a2j_jack_process_internal (self, A2J_PORT_CAPTURE, nframes); 
   a2j_jack_process_internal (self, A2J_PORT_PLAYBACK, nframes); 
@@ -575,6 +1420,20 @@ a2j_jack_process(
   return 0;
 }
 
+static
+void
+a2j_jack_thread_init(
+  void * arg)
+{
+  struct a2j * self = (struct a2j *) arg;
+
+  if (g_a2j_lock_memory)
+  {
+    a2j_prefault_stack();
+    __atomic_store_n(&self->rt_tid, a2j_thread_id(), __ATOMIC_RELEASE);
+  }
+}
+
 static
 void
 a2j_jack_freewheel(
@@ -593,7 +1452,170 @@ a2j_jack_shutdown(
   g_stop_request = true;
 }
 
-#undef a2j_ptr
+static
+int
+a2j_jack_buffer_size(
+  jack_nframes_t nframes,
+  void * arg)
+{
+  struct a2j * self = (struct a2j *) arg;
+
+  /* the delays follow in the next cycle, the main loop then reports them */
+  __atomic_store_n(&self->latency_dirty, true, __ATOMIC_RELAXED);
+  return 0;
+}
+
+static
+void
+a2j_jack_latency(
+  jack_latency_callback_mode_t mode,
+  void * arg)
+{
+  struct a2j * self = (struct a2j *) arg;
+  struct list_head * node_ptr;
+  struct a2j_port * port_ptr;
+
+  pthread_mutex_lock(&self->ports_lock);
+
+  list_for_each(node_ptr, &self->stream[mode == JackCaptureLatency ? A2J_PORT_CAPTURE : A2J_PORT_PLAYBACK].list)
+  {
+    port_ptr = list_entry(node_ptr, struct a2j_port, siblings);
+    if (port_ptr->jack_port != JACK_INVALID_PORT)
+    {
+      self->backend.jack->port_set_latency_range(port_ptr->jack_port, mode, &port_ptr->latency_range);
+    }
+  }
+
+  pthread_mutex_unlock(&self->ports_lock);
+}
+
+static
+jack_nframes_t
+a2j_usecs_to_frames(
+  int64_t usecs,
+  jack_nframes_t sample_rate)
+{
+  if (usecs <= 0)
+  {
+    return 0;
+  }
+
+  return (jack_nframes_t)(usecs * sample_rate / 1000000);
+}
+
+/* capture: events are delivered delay frames after arrival, late ones later still.
+   playback: events leave delay frames after their JACK time plus the output thread lateness */
+static
+void
+a2j_port_latency_range(
+  struct a2j_port * port_ptr,
+  int dir,
+  jack_nframes_t delay,
+  jack_nframes_t sample_rate,
+  jack_latency_range_t * range_ptr)
+{
+  struct a2j_histogram snapshot;
+  jack_nframes_t slowest;
+
+  range_ptr->min = range_ptr->max = delay;
+
+  a2j_histogram_read(&port_ptr->latency, &snapshot);
+  if (snapshot.count == 0)
+  {
+    return;
+  }
+
+  slowest = a2j_usecs_to_frames(a2j_histogram_percentile(&snapshot, A2J_LATENCY_PERCENTILE), sample_rate);
+
+  if (dir == A2J_PORT_CAPTURE)
+  {
+    if (slowest > delay)
+    {
+      range_ptr->max = slowest;
+    }
+  }
+  else
+  {
+    range_ptr->min += a2j_usecs_to_frames(snapshot.min, sample_rate);
+    range_ptr->max += slowest;
+    if (range_ptr->max < range_ptr->min)
+    {
+      range_ptr->max = range_ptr->min;
+    }
+  }
+}
+
+/* measured latency changes smaller than the hysteresis are not worth a graph wide latency recomputation */
+static
+bool
+a2j_latency_moved(
+  jack_nframes_t reported,
+  jack_nframes_t measured)
+{
+  jack_nframes_t difference;
+
+  difference = reported > measured ? reported - measured : measured - reported;
+  return difference > reported / A2J_LATENCY_HYSTERESIS_FRACTION;
+}
+
+void
+a2j_jack_update_latency(
+  struct a2j * self)
+{
+  jack_nframes_t delay[2];
+  jack_nframes_t sample_rate;
+  jack_latency_range_t range;
+  jack_time_t now;
+  struct list_head * node_ptr;
+  struct a2j_port * port_ptr;
+  bool exact;
+  bool changed;
+  int dir;
+
+  delay[A2J_PORT_CAPTURE] = __atomic_load_n(&self->input_delay, __ATOMIC_RELAXED);
+  delay[A2J_PORT_PLAYBACK] = __atomic_load_n(&self->output_delay, __ATOMIC_RELAXED);
+  changed = delay[A2J_PORT_CAPTURE] != self->input_delay_published || delay[A2J_PORT_PLAYBACK] != self->output_delay_published;
+
+  /* configuration changes are reported exactly, measurement drift only past the hysteresis */
+  exact = __atomic_exchange_n(&self->latency_dirty, false, __ATOMIC_RELAXED) || changed;
+
+  now = self->backend.jack->get_time();
+  if (!exact && now - self->latency_updated < A2J_LATENCY_UPDATE_USECS)
+  {
+    return;
+  }
+
+  self->latency_updated = now;
+  self->input_delay_published = delay[A2J_PORT_CAPTURE];
+  self->output_delay_published = delay[A2J_PORT_PLAYBACK];
+  sample_rate = self->backend.jack->get_sample_rate(self->jack_client);
+
+  pthread_mutex_lock(&self->ports_lock);
+
+  for (dir = A2J_PORT_CAPTURE; dir <= A2J_PORT_PLAYBACK; dir++)
+  {
+    list_for_each(node_ptr, &self->stream[dir].list)
+    {
+      port_ptr = list_entry(node_ptr, struct a2j_port, siblings);
+      a2j_port_latency_range(port_ptr, dir, delay[dir], sample_rate, &range);
+      if (exact ?
+          range.min != port_ptr->latency_range.min || range.max != port_ptr->latency_range.max :
+          a2j_latency_moved(port_ptr->latency_range.min, range.min) || a2j_latency_moved(port_ptr->latency_range.max, range.max))
+      {
+        a2j_debug("%s latency %u-%u frames", port_ptr->name, (unsigned int)range.min, (unsigned int)range.max);
+        port_ptr->latency_range = range;
+        changed = true;
+      }
+    }
+  }
+
+  pthread_mutex_unlock(&self->ports_lock);
+
+  if (changed)
+  {
+    self->backend.jack->recompute_total_latencies(self->jack_client);
+  }
+}
 
 jack_client_t *
 a2j_jack_client_create(
@@ -606,11 +1628,11 @@ a2j_jack_client_create(
 
   if (server_name != NULL)
   {
-    jack_client = jack_client_open(client_name, JackServerName|JackNoStartServer|JackUseExactName, &status, server_name);
+    jack_client = a2j_ptr->backend.jack->client_open(client_name, JackServerName|JackNoStartServer|JackUseExactName, &status, server_name);
   }
   else
   {
-    jack_client = jack_client_open(client_name, JackNoStartServer|JackUseExactName, &status);
+    jack_client = a2j_ptr->backend.jack->client_open(client_name, JackNoStartServer|JackUseExactName, &status, NULL);
   }
 
   if (!jack_client)
@@ -619,9 +1641,18 @@ a2j_jack_client_create(
     return NULL;
   }
 
-  jack_set_process_callback(jack_client, a2j_jack_process, a2j_ptr);
-  jack_set_freewheel_callback(jack_client, a2j_jack_freewheel, NULL);
-  jack_on_shutdown(jack_client, a2j_jack_shutdown, NULL);
+  a2j_ptr->input_delay = g_a2j_input_delay != 0 ? g_a2j_input_delay : a2j_ptr->backend.jack->get_buffer_size(jack_client);
+  a2j_ptr->input_delay_published = a2j_ptr->input_delay;
+  a2j_ptr->input_age_max = INT32_MIN;
+  a2j_ptr->output_delay = a2j_output_delay(a2j_ptr->backend.jack->get_buffer_size(jack_client));
+  a2j_ptr->output_delay_published = a2j_ptr->output_delay;
+
+  a2j_ptr->backend.jack->set_thread_init_callback(jack_client, a2j_jack_thread_init, a2j_ptr);
+  a2j_ptr->backend.jack->set_process_callback(jack_client, a2j_jack_process, a2j_ptr);
+  a2j_ptr->backend.jack->set_freewheel_callback(jack_client, a2j_jack_freewheel, NULL);
+  a2j_ptr->backend.jack->set_buffer_size_callback(jack_client, a2j_jack_buffer_size, a2j_ptr);
+  a2j_ptr->backend.jack->set_latency_callback(jack_client, a2j_jack_latency, a2j_ptr);
+  a2j_ptr->backend.jack->on_shutdown(jack_client, a2j_jack_shutdown, NULL);
 
   return jack_client;
 }
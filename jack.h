@@ -22,12 +22,25 @@
 #ifndef JACK_H__A455F430_D6DE_4978_AAE6_517E713FC305__INCLUDED
 #define JACK_H__A455F430_D6DE_4978_AAE6_517E713FC305__INCLUDED
 
-void a2j_add_ports(struct a2j_stream * str);
-
 jack_client_t *
 a2j_jack_client_create(
   struct a2j * a2j_ptr,
   const char * client_name,
   const char * server_name);
 
+void
+a2j_jack_update_latency(
+  struct a2j * self);
+
+/* *first_ptr is set to the deadline of the first event queued, returns events queued */
+int
+a2j_process_outgoing(
+  struct a2j * self,
+  struct a2j_port * port,
+  jack_nframes_t * first_ptr);
+
+void
+a2j_wake_output_thread(
+  struct a2j * self);
+
 #endif /* #ifndef JACK_H__A455F430_D6DE_4978_AAE6_517E713FC305__INCLUDED */
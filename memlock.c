@@ -0,0 +1,182 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * ALSA SEQ < - > JACK MIDI bridge
+ *
+ * Copyright (c) 2026 The a2jmidid authors
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE             /* RUSAGE_THREAD */
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "memlock.h"
+#include "log.h"
+
+#ifndef MCL_ONFAULT
+#define MCL_ONFAULT 4
+#endif
+
+#define A2J_PREFAULT_STACK_SIZE (64 * 1024)
+
+/* Lock every page we touch from now on. MCL_ONFAULT keeps the reserved
+ * but unused parts of the port slabs from being committed; what the
+ * threads need is faulted in explicitly instead. Kernels before 4.4 do
+ * not know it, they lock and commit everything mapped. */
+bool
+a2j_memlock_init(void)
+{
+  if (mlockall(MCL_CURRENT | MCL_FUTURE | MCL_ONFAULT) == 0)
+  {
+    return true;
+  }
+
+  if (errno == EINVAL)
+  {
+    a2j_info("mlockall() does not support MCL_ONFAULT, locking all mapped memory");
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0)
+    {
+      return true;
+    }
+  }
+
+  a2j_warning("mlockall() failed, only port memory will be locked: %s", strerror(errno));
+  return false;
+}
+
+/* fault in the top of the calling thread stack */
+void
+a2j_prefault_stack(void)
+{
+  volatile char stack[A2J_PREFAULT_STACK_SIZE];
+  size_t i;
+
+  for (i = 0; i < sizeof(stack); i += 1024)
+  {
+    stack[i] = 0;
+  }
+}
+
+void
+a2j_memlock_report(void)
+{
+  FILE * file;
+  char line[128];
+
+  file = fopen("/proc/self/status", "r");
+  if (file == NULL)
+  {
+    return;
+  }
+
+  while (fgets(line, sizeof(line), file) != NULL)
+  {
+    if (strncmp(line, "VmLck:", 6) == 0)
+    {
+      line[strcspn(line, "\n")] = 0;
+      a2j_info("Locked memory: %s", line + strspn(line + 6, " \t") + 6);
+      break;
+    }
+  }
+
+  fclose(file);
+}
+
+/* kernel id of the calling thread, for a2j_thread_faults() from another thread */
+pid_t
+a2j_thread_id(void)
+{
+  return syscall(SYS_gettid);
+}
+
+/* page faults of a thread of this process so far, read from procfs so
+   the thread itself does not have to make a syscall */
+bool
+a2j_thread_faults(
+  pid_t tid,
+  unsigned long * minor_ptr,
+  unsigned long * major_ptr)
+{
+  char path[64];
+  char line[1024];
+  FILE * file;
+  char * fields;
+  bool ret;
+
+  snprintf(path, sizeof(path), "/proc/self/task/%d/stat", (int)tid);
+  file = fopen(path, "r");
+  if (file == NULL)
+  {
+    return false;
+  }
+
+  ret = false;
+  if (fgets(line, sizeof(line), file) != NULL)
+  {
+    /* the thread name may contain spaces and parentheses, fields follow the last ')' */
+    fields = strrchr(line, ')');
+    ret = fields != NULL &&
+      sscanf(fields + 1, " %*c %*d %*d %*d %*d %*d %*u %lu %*u %lu", minor_ptr, major_ptr) == 2;
+  }
+
+  fclose(file);
+  return ret;
+}
+
+/* user and system CPU time of the calling thread so far, in seconds */
+double
+a2j_thread_cpu_time(void)
+{
+  struct rusage usage;
+
+  if (getrusage(RUSAGE_THREAD, &usage) != 0)
+  {
+    return 0;
+  }
+
+  return
+    usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+    (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+/* CPU time a thread of this process used so far, read without its help */
+bool
+a2j_thread_cpu_nsecs(
+  pthread_t thread,
+  uint64_t * nsecs_ptr)
+{
+  clockid_t clock;
+  struct timespec ts;
+
+  if (pthread_getcpuclockid(thread, &clock) != 0 || clock_gettime(clock, &ts) != 0)
+  {
+    return false;
+  }
+
+  *nsecs_ptr = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+  return true;
+}
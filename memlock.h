@@ -0,0 +1,50 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * ALSA SEQ < - > JACK MIDI bridge
+ *
+ * Copyright (c) 2026 The a2jmidid authors
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ */
+
+#ifndef MEMLOCK_H__1F972F2A_7C16_4766_9708_C5762A76C608__INCLUDED
+#define MEMLOCK_H__1F972F2A_7C16_4766_9708_C5762A76C608__INCLUDED
+
+bool
+a2j_memlock_init(void);
+
+void
+a2j_prefault_stack(void);
+
+void
+a2j_memlock_report(void);
+
+pid_t
+a2j_thread_id(void);
+
+bool
+a2j_thread_faults(
+  pid_t tid,
+  unsigned long * minor_ptr,
+  unsigned long * major_ptr);
+
+double
+a2j_thread_cpu_time(void);
+
+bool
+a2j_thread_cpu_nsecs(
+  pthread_t thread,
+  uint64_t * nsecs_ptr);
+
+#endif /* #ifndef MEMLOCK_H__1F972F2A_7C16_4766_9708_C5762A76C608__INCLUDED */
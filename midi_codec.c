@@ -0,0 +1,259 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * ALSA SEQ < - > JACK MIDI bridge
+ *
+ * Copyright (c) 2026 The a2jmidid authors
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ */
+
+#include <stdbool.h>
+#include <alsa/asoundlib.h>
+
+#include "midi_codec.h"
+
+/* sequencer event type and length of each channel message, indexed by status >> 4 */
+static const struct
+{
+  snd_seq_event_type_t type;
+  unsigned char length;
+} g_a2j_channel_messages[8] =
+{
+  { SND_SEQ_EVENT_NOTEOFF, 3 },    /* 0x80 */
+  { SND_SEQ_EVENT_NOTEON, 3 },     /* 0x90 */
+  { SND_SEQ_EVENT_KEYPRESS, 3 },   /* 0xA0 */
+  { SND_SEQ_EVENT_CONTROLLER, 3 }, /* 0xB0 */
+  { SND_SEQ_EVENT_PGMCHANGE, 2 },  /* 0xC0 */
+  { SND_SEQ_EVENT_CHANPRESS, 2 },  /* 0xD0 */
+  { SND_SEQ_EVENT_PITCHBEND, 3 },  /* 0xE0 */
+  { SND_SEQ_EVENT_NONE, 0 },       /* 0xF0, see g_a2j_system_messages */
+};
+
+/* same for system messages, indexed by status & 0x0F; SysEx and undefined ones are not converted */
+static const struct
+{
+  snd_seq_event_type_t type;
+  unsigned char length;
+} g_a2j_system_messages[16] =
+{
+  { SND_SEQ_EVENT_NONE, 0 },         /* 0xF0 SysEx */
+  { SND_SEQ_EVENT_QFRAME, 2 },       /* 0xF1 */
+  { SND_SEQ_EVENT_SONGPOS, 3 },      /* 0xF2 */
+  { SND_SEQ_EVENT_SONGSEL, 2 },      /* 0xF3 */
+  { SND_SEQ_EVENT_NONE, 0 },         /* 0xF4 */
+  { SND_SEQ_EVENT_NONE, 0 },         /* 0xF5 */
+  { SND_SEQ_EVENT_TUNE_REQUEST, 1 }, /* 0xF6 */
+  { SND_SEQ_EVENT_NONE, 0 },         /* 0xF7 end of SysEx */
+  { SND_SEQ_EVENT_CLOCK, 1 },        /* 0xF8 */
+  { SND_SEQ_EVENT_NONE, 0 },         /* 0xF9 */
+  { SND_SEQ_EVENT_START, 1 },        /* 0xFA */
+  { SND_SEQ_EVENT_CONTINUE, 1 },     /* 0xFB */
+  { SND_SEQ_EVENT_STOP, 1 },         /* 0xFC */
+  { SND_SEQ_EVENT_NONE, 0 },         /* 0xFD */
+  { SND_SEQ_EVENT_SENSING, 1 },      /* 0xFE */
+  { SND_SEQ_EVENT_RESET, 1 },        /* 0xFF */
+};
+
+long
+a2j_midi_decode_fast(
+  const snd_seq_event_t * ev,
+  unsigned char * buf,
+  long count)
+{
+  int value;
+
+  if (count < 3)
+  {
+    return 0;
+  }
+
+  switch (ev->type)
+  {
+  case SND_SEQ_EVENT_NOTEOFF:
+  case SND_SEQ_EVENT_NOTEON:
+  case SND_SEQ_EVENT_KEYPRESS:
+    buf[0] = (ev->type == SND_SEQ_EVENT_NOTEOFF ? 0x80 : ev->type == SND_SEQ_EVENT_NOTEON ? 0x90 : 0xA0) | (ev->data.note.channel & 0x0F);
+    buf[1] = ev->data.note.note & 0x7F;
+    buf[2] = ev->data.note.velocity & 0x7F;
+    return 3;
+  case SND_SEQ_EVENT_CONTROLLER:
+    buf[0] = 0xB0 | (ev->data.control.channel & 0x0F);
+    buf[1] = ev->data.control.param & 0x7F;
+    buf[2] = ev->data.control.value & 0x7F;
+    return 3;
+  case SND_SEQ_EVENT_PGMCHANGE:
+    buf[0] = 0xC0 | (ev->data.control.channel & 0x0F);
+    buf[1] = ev->data.control.value & 0x7F;
+    return 2;
+  case SND_SEQ_EVENT_CHANPRESS:
+    buf[0] = 0xD0 | (ev->data.control.channel & 0x0F);
+    buf[1] = ev->data.control.value & 0x7F;
+    return 2;
+  case SND_SEQ_EVENT_PITCHBEND:
+    value = ev->data.control.value + 8192;
+    buf[0] = 0xE0 | (ev->data.control.channel & 0x0F);
+    buf[1] = value & 0x7F;
+    buf[2] = (value >> 7) & 0x7F;
+    return 3;
+  case SND_SEQ_EVENT_QFRAME:
+    buf[0] = 0xF1;
+    buf[1] = ev->data.control.value & 0x7F;
+    return 2;
+  case SND_SEQ_EVENT_SONGPOS:
+    buf[0] = 0xF2;
+    buf[1] = ev->data.control.value & 0x7F;
+    buf[2] = (ev->data.control.value >> 7) & 0x7F;
+    return 3;
+  case SND_SEQ_EVENT_SONGSEL:
+    buf[0] = 0xF3;
+    buf[1] = ev->data.control.value & 0x7F;
+    return 2;
+  case SND_SEQ_EVENT_TUNE_REQUEST:
+    buf[0] = 0xF6;
+    return 1;
+  case SND_SEQ_EVENT_CLOCK:
+    buf[0] = 0xF8;
+    return 1;
+  case SND_SEQ_EVENT_START:
+    buf[0] = 0xFA;
+    return 1;
+  case SND_SEQ_EVENT_CONTINUE:
+    buf[0] = 0xFB;
+    return 1;
+  case SND_SEQ_EVENT_STOP:
+    buf[0] = 0xFC;
+    return 1;
+  case SND_SEQ_EVENT_SENSING:
+    buf[0] = 0xFE;
+    return 1;
+  case SND_SEQ_EVENT_RESET:
+    buf[0] = 0xFF;
+    return 1;
+  }
+
+  return 0;
+}
+
+long
+a2j_midi_encode_fast(
+  unsigned char * running_status_ptr,
+  const unsigned char * buf,
+  long count,
+  snd_seq_event_t * ev)
+{
+  unsigned char status;
+  unsigned char channel;
+  const unsigned char * data;   /* first data byte */
+  long length;                  /* data bytes */
+  long i;
+
+  if (count < 1)
+  {
+    return 0;
+  }
+
+  if (buf[0] < 0x80)
+  {
+    /* data bytes continuing the last channel message converted here */
+    if (*running_status_ptr == 0)
+    {
+      return 0;
+    }
+
+    status = *running_status_ptr;
+    data = buf;
+    length = count;
+  }
+  else
+  {
+    status = buf[0];
+    data = buf + 1;
+    length = count - 1;
+  }
+
+  channel = status & 0x0F;
+
+  if (length + 1 != (status < 0xF0 ? g_a2j_channel_messages[(status >> 4) - 8].length : g_a2j_system_messages[channel].length))
+  {
+    return 0;
+  }
+
+  /* data bytes must not have the status bit set */
+  for (i = 0; i < length; i++)
+  {
+    if (data[i] & 0x80)
+    {
+      return 0;
+    }
+  }
+
+  /* channel messages set running status, system common messages cancel it, realtime ones leave it alone */
+  if (status < 0xF0)
+  {
+    *running_status_ptr = status;
+  }
+  else if (status < 0xF8)
+  {
+    *running_status_ptr = 0;
+  }
+
+  if (status < 0xF0)
+  {
+    ev->type = g_a2j_channel_messages[(status >> 4) - 8].type;
+
+    switch (status & 0xF0)
+    {
+    case 0x80:
+    case 0x90:
+    case 0xA0:
+      ev->data.note.channel = channel;
+      ev->data.note.note = data[0];
+      ev->data.note.velocity = data[1];
+      break;
+    case 0xB0:
+      ev->data.control.channel = channel;
+      ev->data.control.param = data[0];
+      ev->data.control.value = data[1];
+      break;
+    case 0xC0:
+    case 0xD0:
+      ev->data.control.channel = channel;
+      ev->data.control.value = data[0];
+      break;
+    case 0xE0:
+      ev->data.control.channel = channel;
+      ev->data.control.value = (data[0] | (data[1] << 7)) - 8192;
+      break;
+    }
+  }
+  else
+  {
+    ev->type = g_a2j_system_messages[channel].type;
+
+    switch (status)
+    {
+    case 0xF1:
+    case 0xF3:
+      ev->data.control.value = data[0];
+      break;
+    case 0xF2:
+      ev->data.control.value = data[0] | (data[1] << 7);
+      break;
+    }
+  }
+
+  snd_seq_ev_set_fixed(ev);
+
+  return count;
+}
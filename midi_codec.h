@@ -0,0 +1,45 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * ALSA SEQ < - > JACK MIDI bridge
+ *
+ * Copyright (c) 2026 The a2jmidid authors
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ */
+
+#ifndef MIDI_CODEC_H__E8B2D5C1_7F34_4A06_B9E1_52C0A3D7F914__INCLUDED
+#define MIDI_CODEC_H__E8B2D5C1_7F34_4A06_B9E1_52C0A3D7F914__INCLUDED
+
+/* Direct conversion of channel, system common and realtime messages.
+ * SysEx, RPN/NRPN and 14 bit controller events are left to snd_midi_event,
+ * these functions return 0 for them and for anything else not converted. */
+
+/* returns bytes written to buf */
+long
+a2j_midi_decode_fast(
+  const snd_seq_event_t * ev,
+  unsigned char * buf,
+  long count);
+
+/* buf must hold exactly one complete message of count bytes, returns count if converted.
+ * A message without status byte continues the running status kept in
+ * *running_status_ptr, which is 0 when there is none. */
+long
+a2j_midi_encode_fast(
+  unsigned char * running_status_ptr,
+  const unsigned char * buf,
+  long count,
+  snd_seq_event_t * ev);
+
+#endif /* #ifndef MIDI_CODEC_H__E8B2D5C1_7F34_4A06_B9E1_52C0A3D7F914__INCLUDED */
@@ -22,15 +22,17 @@
 #include <stdbool.h>
 #include <ctype.h>
 #include <semaphore.h>
+#include <pthread.h>
 #include <alsa/asoundlib.h>
 #include <jack/jack.h>
 #include <jack/ringbuffer.h>
 
 #include "list.h"
 #include "structs.h"
-#include "port_hash.h"
+#include "port_table.h"
 #include "log.h"
 #include "port.h"
+#include "conf.h"
 
 extern bool g_disable_port_uniqueness;
 
@@ -69,35 +71,138 @@ a2j_alsa_connect_from(
   snd_seq_port_subscribe_set_queue(sub, self->queue);
   snd_seq_port_subscribe_set_time_real(sub, 1);
 
-  if ((err=snd_seq_subscribe_port(self->seq, sub)))
+  if ((err=self->backend.seq->subscribe_port(self->seq, sub)))
     a2j_error("can't subscribe to %d:%d - %s", client, port, snd_strerror(err));
   return err;
 }
 
 void
 a2j_port_setdead(
-  a2j_port_hash_t hash,
+  a2j_port_table_t table,
   snd_seq_addr_t addr)
 {
-  struct a2j_port *port = a2j_port_get(hash, addr);
+  struct a2j_port *port = a2j_port_get(table, addr);
   if (port)
     port->is_dead = true; // see jack_process_internal
   else
     a2j_debug("port_setdead: not found (%d:%d)", addr.client, addr.port);
 }
 
+#define A2J_PORT_ALIGN 64
+
+/* Every port lives in one slot of its stream slab: the port struct and
+ * its name, then the ringbuffer data, a power of two like
+ * jack_ringbuffer_create() would allocate. */
+bool
+a2j_port_slab_init(
+  struct a2j_stream * stream_ptr,
+  int type)
+{
+  size_t ring_size;
+  size_t header_size;
+
+  ring_size = type == A2J_PORT_CAPTURE ? MAX_EVENT_SIZE * 16 : A2J_OUTBOUND_EVENTS_SIZE;
+
+  stream_ptr->port_ring_size = 1;
+  while (stream_ptr->port_ring_size < ring_size)
+  {
+    stream_ptr->port_ring_size <<= 1;
+  }
+
+  header_size = (sizeof(struct a2j_port) + g_max_jack_port_name_size + A2J_PORT_ALIGN - 1) & ~((size_t)A2J_PORT_ALIGN - 1);
+
+  return a2j_slab_init(&stream_ptr->port_slab, header_size + stream_ptr->port_ring_size, MAX_PORTS, g_a2j_lock_memory);
+}
+
+/* give SysEx buffers held by a capture port back to the pool */
+static
+void
+a2j_port_release_sysex(
+  struct a2j_port * port)
+{
+  struct a2j_sysex_pool * pool_ptr = &port->a2j_ptr->sysex_pool;
+  struct a2j_alsa_midi_event ev;
+
+  if (port->sysex_assembly != NULL)
+  {
+    a2j_sysex_put(pool_ptr, port->sysex_assembly);
+  }
+
+  while (port->sysex_pending_count > 0)
+  {
+    a2j_sysex_put(pool_ptr, port->sysex_pending[port->sysex_pending_head]);
+    port->sysex_pending_head = (port->sysex_pending_head + 1) % A2J_SYSEX_POOL_SIZE;
+    port->sysex_pending_count--;
+  }
+
+  while (jack_ringbuffer_read(port->inbound_events, (char *)&ev, sizeof(ev)) == sizeof(ev))
+  {
+    if (ev.sysex != NULL)
+    {
+      a2j_sysex_put(pool_ptr, ev.sysex);
+    }
+    else
+    {
+      jack_ringbuffer_read_advance(port->inbound_events, ev.size);
+    }
+  }
+}
+
+/* give the SysEx buffers of events a playback port did not send back to the pool */
+static
+void
+a2j_port_release_outbound(
+  struct a2j_port * port)
+{
+  struct a2j_delivery_event ev;
+
+  while (jack_ringbuffer_read(port->outbound_events, (char *)&ev, sizeof(ev)) == sizeof(ev))
+  {
+    if (ev.sysex != NULL)
+    {
+      a2j_sysex_put(&port->a2j_ptr->sysex_out_pool, ev.sysex);
+    }
+    else
+    {
+      jack_ringbuffer_read_advance(port->outbound_events, ev.size);
+    }
+  }
+}
+
 void
 a2j_port_free(
   struct a2j_port * port)
 {
+  struct a2j_port_stats stats;
+
   //snd_seq_disconnect_from(self->seq, self->port_id, port->remote.client, port->remote.port);
   //snd_seq_disconnect_to(self->seq, self->port_id, port->remote.client, port->remote.port);
+  a2j_port_stats_read(&port->stats, &stats);
+  a2j_port_stats_accumulate(&port->a2j_ptr->stats.retired[port->inbound_events != NULL ? A2J_PORT_CAPTURE : A2J_PORT_PLAYBACK], &stats);
+
+  if (stats.dropped_ring_full != 0 || stats.dropped_jack_buffer != 0 || stats.dropped_sysex != 0 ||
+      stats.dropped_too_large != 0 || stats.codec_errors != 0 || stats.output_errors != 0)
+  {
+    a2j_info(
+      "port '%s': %llu events, %llu lost to full buffers, %llu SysEx lost, %llu too large, %llu codec and %llu output errors",
+      port->name,
+      (unsigned long long)stats.events,
+      (unsigned long long)(stats.dropped_ring_full + stats.dropped_jack_buffer),
+      (unsigned long long)stats.dropped_sysex,
+      (unsigned long long)stats.dropped_too_large,
+      (unsigned long long)stats.codec_errors,
+      (unsigned long long)stats.output_errors);
+  }
+
   if (port->inbound_events)
-    jack_ringbuffer_free(port->inbound_events);
+    a2j_port_release_sysex(port);
+  else
+    a2j_port_release_outbound(port);
   if (port->jack_port != JACK_INVALID_PORT)
-    jack_port_unregister(port->a2j_ptr->jack_client, port->jack_port);
+    port->a2j_ptr->backend.jack->port_unregister(port->a2j_ptr->jack_client, port->jack_port);
+  snd_midi_event_free(port->codec);
 
-  free(port);
+  a2j_slab_free(port->slab_ptr, port);
 }
 
 void
@@ -172,7 +277,7 @@ a2j_port_create(
 
   client = snd_seq_port_info_get_client(info);
 
-  err = snd_seq_get_any_client_info(self->seq, client, client_info_ptr);
+  err = self->backend.seq->get_any_client_info(self->seq, client, client_info_ptr);
   if (err != 0)
   {
     a2j_error("Failed to get client info");
@@ -182,21 +287,48 @@ a2j_port_create(
   a2j_debug("client name: '%s'", snd_seq_client_info_get_name(client_info_ptr));
   a2j_debug("port name: '%s'", snd_seq_port_info_get_name(info));
 
-  port = calloc(1, sizeof(struct a2j_port) + g_max_jack_port_name_size);
+  port = a2j_slab_alloc(&stream_ptr->port_slab);
   if (!port)
   {
+    a2j_error("No room for more than %u ports", stream_ptr->port_slab.capacity);
     goto fail_free_client_info;
   }
 
   port->a2j_ptr = self;
+  port->slab_ptr = &stream_ptr->port_slab;
+
+  /* read and write pointers start zeroed, like the rest of the slot */
+  port->events_ring.size = stream_ptr->port_ring_size;
+  port->events_ring.size_mask = stream_ptr->port_ring_size - 1;
+  port->events_ring.buf = (char *)port + stream_ptr->port_slab.stride - stream_ptr->port_ring_size;
+  if (type == A2J_PORT_CAPTURE)
+  {
+    port->inbound_events = &port->events_ring;
+  }
+  else
+  {
+    port->outbound_events = &port->events_ring;
+  }
+
+  if (snd_midi_event_new(MAX_EVENT_SIZE, &port->codec) < 0)
+  {
+    a2j_error("Failed to create MIDI codec");
+    a2j_slab_free(&stream_ptr->port_slab, port);
+    goto fail_free_client_info;
+  }
 
   port->jack_port = JACK_INVALID_PORT;
   port->remote = addr;
+  a2j_histogram_reset(&port->latency);
+  port->latency_range.min = port->latency_range.max =
+    __atomic_load_n(type == A2J_PORT_CAPTURE ? &self->input_delay : &self->output_delay, __ATOMIC_RELAXED);
 
   a2j_port_fill_name(port, type, client_info_ptr, info, !g_disable_port_uniqueness);
 
   /* Add port to list early, before registering to JACK, so map functionality is guaranteed to work during port registration */
+  pthread_mutex_lock(&self->ports_lock);
   list_add_tail(&port->siblings, &stream_ptr->list);
+  pthread_mutex_unlock(&self->ports_lock);
 
   if (type == A2J_PORT_CAPTURE)
   {
@@ -213,7 +345,7 @@ a2j_port_create(
     jack_caps |= JackPortIsPhysical|JackPortIsTerminal;
   }
 
-  port->jack_port = jack_port_register(self->jack_client, port->name, JACK_DEFAULT_MIDI_TYPE, jack_caps, 0);
+  port->jack_port = self->backend.jack->port_register(self->jack_client, port->name, JACK_DEFAULT_MIDI_TYPE, jack_caps, 0);
   if (port->jack_port == JACK_INVALID_PORT)
   {
     a2j_error("jack_port_register() failed for '%s'", port->name);
@@ -226,7 +358,7 @@ a2j_port_create(
   }
   else
   {
-    err = snd_seq_connect_to(self->seq, self->port_id, port->remote.client, port->remote.port);
+    err = self->backend.seq->connect_to(self->seq, self->port_id, port->remote.client, port->remote.port);
     if (err != 0)
     {
       a2j_error("snd_seq_connect_to() for %d:%d failed with error %d", (int)port->remote.client, (int)port->remote.port, err);
@@ -239,14 +371,20 @@ a2j_port_create(
     goto fail_free_port;
   }
 
-  port->inbound_events = jack_ringbuffer_create(MAX_EVENT_SIZE*16);
+  if (!a2j_port_insert(stream_ptr->port_table, port))
+  {
+    a2j_error("Failed to allocate port table row for client %d", (int)port->remote.client);
+    goto fail_free_port;
+  }
 
   a2j_info("port created: %s", port->name);
   snd_seq_client_info_free(client_info_ptr);
   return port;
 
 fail_free_port:
+  pthread_mutex_lock(&self->ports_lock);
   list_del(&port->siblings);
+  pthread_mutex_unlock(&self->ports_lock);
 
   a2j_port_free(port);
 
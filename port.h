@@ -22,6 +22,11 @@
 #ifndef PORT_H__757ADD0F_5E53_41F7_8B7F_8119C5E8A9F1__INCLUDED
 #define PORT_H__757ADD0F_5E53_41F7_8B7F_8119C5E8A9F1__INCLUDED
 
+bool
+a2j_port_slab_init(
+  struct a2j_stream * stream_ptr,
+  int type);
+
 struct a2j_port *
 a2j_port_create(
   struct a2j * self,
@@ -31,7 +36,7 @@ a2j_port_create(
 
 void
 a2j_port_setdead(
-  a2j_port_hash_t hash,
+  a2j_port_table_t table,
   snd_seq_addr_t addr);
 
 void
@@ -0,0 +1,100 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * ALSA SEQ < - > JACK MIDI bridge
+ *
+ * Copyright (c) 2006,2007 Dmitry S. Baikov <c0ff@konstruktiv.org>
+ * Copyright (c) 2007,2008,2009 Nedko Arnaudov <nedko@arnaudov.name>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ */
+
+#include <stdbool.h>
+#include <semaphore.h>
+#include <alsa/asoundlib.h>
+#include <jack/jack.h>
+#include <jack/ringbuffer.h>
+
+#include "list.h"
+#include "structs.h"
+#include "port_table.h"
+
+/*
+ * ALSA sequencer addresses are two bytes, so ports are indexed directly
+ * by client and port. Per-client rows are allocated on first insert and
+ * live until the stream is closed, so readers never see a row go away.
+ * Rows and slots are published with atomic stores, so lookups from the
+ * ALSA input thread are two dependent loads.
+ */
+
+struct a2j_port *
+a2j_port_get(
+  a2j_port_table_t table,
+  snd_seq_addr_t addr)
+{
+  struct a2j_port ** row;
+
+  row = __atomic_load_n(&table[addr.client], __ATOMIC_ACQUIRE);
+  if (row == NULL)
+    return NULL;
+
+  return __atomic_load_n(&row[addr.port], __ATOMIC_ACQUIRE);
+}
+
+bool
+a2j_port_insert(
+  a2j_port_table_t table,
+  struct a2j_port * port)
+{
+  struct a2j_port ** row;
+
+  row = table[port->remote.client];
+  if (row == NULL) {
+    row = calloc(PORT_TABLE_PORTS, sizeof(struct a2j_port *));
+    if (row == NULL)
+      return false;
+    __atomic_store_n(&table[port->remote.client], row, __ATOMIC_RELEASE);
+  }
+
+  __atomic_store_n(&row[port->remote.port], port, __ATOMIC_RELEASE);
+  return true;
+}
+
+void
+a2j_port_remove(
+  a2j_port_table_t table,
+  struct a2j_port * port)
+{
+  struct a2j_port ** row;
+  struct a2j_port * expected;
+
+  row = __atomic_load_n(&table[port->remote.client], __ATOMIC_ACQUIRE);
+  if (row == NULL)
+    return;
+
+  /* leave the slot alone if it was already reused for a new port at the same address */
+  expected = port;
+  __atomic_compare_exchange_n(&row[port->remote.port], &expected, NULL, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+}
+
+void
+a2j_port_table_free(
+  a2j_port_table_t table)
+{
+  int client;
+
+  for (client = 0; client < PORT_TABLE_CLIENTS; client++) {
+    free(table[client]);
+    table[client] = NULL;
+  }
+}
@@ -19,17 +19,26 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
  */
 
-#ifndef PORT_HASH_H__A44CBCD6_E075_49CB_8F73_DF9772511D55__INCLUDED
-#define PORT_HASH_H__A44CBCD6_E075_49CB_8F73_DF9772511D55__INCLUDED
+#ifndef PORT_TABLE_H__A44CBCD6_E075_49CB_8F73_DF9772511D55__INCLUDED
+#define PORT_TABLE_H__A44CBCD6_E075_49CB_8F73_DF9772511D55__INCLUDED
 
-void
+bool
 a2j_port_insert(
-  a2j_port_hash_t hash,
+  a2j_port_table_t table,
+  struct a2j_port * port);
+
+void
+a2j_port_remove(
+  a2j_port_table_t table,
   struct a2j_port * port);
 
 struct a2j_port *
 a2j_port_get(
-  a2j_port_hash_t hash,
+  a2j_port_table_t table,
   snd_seq_addr_t addr);
 
-#endif /* #ifndef PORT_HASH_H__A44CBCD6_E075_49CB_8F73_DF9772511D55__INCLUDED */
+void
+a2j_port_table_free(
+  a2j_port_table_t table);
+
+#endif /* #ifndef PORT_TABLE_H__A44CBCD6_E075_49CB_8F73_DF9772511D55__INCLUDED */
@@ -21,6 +21,7 @@
 
 #include <stdbool.h>
 #include <semaphore.h>
+#include <pthread.h>
 #include <alsa/asoundlib.h>
 #include <jack/jack.h>
 #include <jack/ringbuffer.h>
@@ -28,9 +29,10 @@
 #include "list.h"
 #include "structs.h"
 #include "port.h"
-#include "port_hash.h"
+#include "port_table.h"
 #include "log.h"
 #include "port_thread.h"
+#include "jack.h"
 #include "conf.h"
 
 struct a2j_port *
@@ -73,6 +75,119 @@ a2j_find_port_by_jack_port_name(
   return NULL;
 }
 
+/*
+ * ==================== Port array publishing ==============================
+ */
+
+void
+a2j_publish_ports(
+  struct a2j_stream * stream_ptr)
+{
+  struct list_head * node_ptr;
+  struct a2j_port_array * array_ptr;
+  struct a2j_port_array * old_array_ptr;
+  unsigned int count;
+
+  count = 0;
+  list_for_each(node_ptr, &stream_ptr->list)
+  {
+    count++;
+  }
+
+  array_ptr = malloc(sizeof(struct a2j_port_array) + count * sizeof(struct a2j_port *));
+  if (array_ptr == NULL)
+  {
+    a2j_error("malloc() failed to allocate port array for %u ports", count);
+    stream_ptr->ports_dirty = true;
+    return;
+  }
+
+  array_ptr->retired_next = NULL;
+  array_ptr->count = 0;
+  list_for_each(node_ptr, &stream_ptr->list)
+  {
+    array_ptr->ports[array_ptr->count++] = list_entry(node_ptr, struct a2j_port, siblings);
+  }
+
+  old_array_ptr = stream_ptr->active_ports;
+  __atomic_store_n(&stream_ptr->active_ports, array_ptr, __ATOMIC_RELEASE);
+  stream_ptr->ports_dirty = false;
+
+  if (old_array_ptr != NULL)
+  {
+    old_array_ptr->retired_next = stream_ptr->retired_ports;
+    stream_ptr->retired_ports = old_array_ptr;
+  }
+}
+
+void
+a2j_reclaim_ports(
+  struct a2j * self)
+{
+  struct a2j_stream * stream_ptr;
+  struct a2j_port_array * array_ptr;
+  struct a2j_port * port_ptr;
+  struct list_head * node_ptr;
+  bool quiescent;
+  int dir;
+
+  quiescent = true;
+
+  for (dir = A2J_PORT_CAPTURE; dir <= A2J_PORT_PLAYBACK; dir++)
+  {
+    stream_ptr = &self->stream[dir];
+
+    if (stream_ptr->ports_dirty)
+    {
+      a2j_publish_ports(stream_ptr);
+    }
+
+    if (stream_ptr->ports_dirty ||
+        __atomic_load_n(&stream_ptr->rt_ports, __ATOMIC_ACQUIRE) != stream_ptr->active_ports)
+    {
+      /* jack process did not pick up the latest array yet */
+      quiescent = false;
+      continue;
+    }
+
+    if (__atomic_load_n(&stream_ptr->in_ports, __ATOMIC_ACQUIRE) != stream_ptr->active_ports)
+    {
+      /* the input thread may still use a port it looked up in the table, it moves on within A2J_CLOCK_SAMPLE_USECS */
+      quiescent = false;
+      continue;
+    }
+
+    if (dir == A2J_PORT_PLAYBACK &&
+        __atomic_load_n(&stream_ptr->out_ports, __ATOMIC_ACQUIRE) != stream_ptr->active_ports)
+    {
+      /* the output thread may be waiting for events, wake it up so it picks up the latest array */
+      a2j_wake_output_thread(self);
+      quiescent = false;
+      continue;
+    }
+
+    while (stream_ptr->retired_ports != NULL)
+    {
+      array_ptr = stream_ptr->retired_ports;
+      stream_ptr->retired_ports = array_ptr->retired_next;
+      free(array_ptr);
+    }
+  }
+
+  if (!quiescent)
+  {
+    return;
+  }
+
+  while (!list_empty(&self->zombie_ports))
+  {
+    node_ptr = self->zombie_ports.next;
+    list_del(node_ptr);
+    port_ptr = list_entry(node_ptr, struct a2j_port, siblings);
+    a2j_port_free(port_ptr);
+  }
+}
+
 /*
  * ==================== Port add/del handling thread ==============================
  */
@@ -111,14 +226,10 @@ a2j_update_port_type(
 
   if (port_ptr == NULL && (caps & alsa_mask) == alsa_mask)
   {
-    if(jack_ringbuffer_write_space(stream_ptr->new_ports) >= sizeof(port_ptr)) {
-      port_ptr = a2j_port_create(self, type, addr, info);
-      if (port_ptr != NULL)
-      {
-	jack_ringbuffer_write(stream_ptr->new_ports, (char *)&port_ptr, sizeof(port_ptr));
-      }
-    } else {
-      a2j_error( "dropping new port event... increase MAX_PORTS" );
+    port_ptr = a2j_port_create(self, type, addr, info);
+    if (port_ptr != NULL)
+    {
+      a2j_publish_ports(stream_ptr);
     }
   }
 }
@@ -235,18 +346,50 @@ a2j_update_port(
 
 void
 a2j_free_ports(
-  jack_ringbuffer_t * ports)
+  struct a2j * self)
 {
   struct a2j_port *port;
   int sz;
-  while ((sz = jack_ringbuffer_read(ports, (char*)&port, sizeof(port)))) {
+  bool deleted = false;
+
+  while ((sz = jack_ringbuffer_read(self->port_del, (char*)&port, sizeof(port)))) {
     assert (sz == sizeof(port));
     a2j_info("port deleted: %s", port->name);
+    pthread_mutex_lock(&self->ports_lock);
     list_del(&port->siblings);
-    a2j_port_free(port);
+    pthread_mutex_unlock(&self->ports_lock);
+    /* jack process may still see the port through the active array, free it in a2j_reclaim_ports() */
+    list_add_tail(&port->siblings, &self->zombie_ports);
+    deleted = true;
+  }
+
+  if (deleted)
+  {
+    a2j_publish_ports(&self->stream[A2J_PORT_CAPTURE]);
+    a2j_publish_ports(&self->stream[A2J_PORT_PLAYBACK]);
   }
 }
 
+void
+a2j_free_port_arrays(
+  struct a2j_stream * stream_ptr)
+{
+  struct a2j_port_array * array_ptr;
+
+  while (stream_ptr->retired_ports != NULL)
+  {
+    array_ptr = stream_ptr->retired_ports;
+    stream_ptr->retired_ports = array_ptr->retired_next;
+    free(array_ptr);
+  }
+
+  free(stream_ptr->active_ports);
+  stream_ptr->active_ports = NULL;
+  stream_ptr->rt_ports = NULL;
+  stream_ptr->out_ports = NULL;
+  stream_ptr->in_ports = NULL;
+}
+
 void
 a2j_update_ports(
   struct a2j * self)
@@ -262,7 +405,7 @@ a2j_update_ports(
     snd_seq_port_info_alloca(&info);
     assert(size == sizeof(addr));
     assert(addr.client != self->client_id);
-    if ((err = snd_seq_get_any_port_info(self->seq, addr.client, addr.port, info)) >= 0)
+    if ((err = self->backend.seq->get_any_port_info(self->seq, addr.client, addr.port, info)) >= 0)
     {
       a2j_update_port(self, addr, info);
     }
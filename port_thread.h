@@ -34,7 +34,19 @@ a2j_update_ports(
 
 void
 a2j_free_ports(
-  jack_ringbuffer_t * ports);
+  struct a2j * self);
+
+void
+a2j_publish_ports(
+  struct a2j_stream * stream_ptr);
+
+void
+a2j_reclaim_ports(
+  struct a2j * self);
+
+void
+a2j_free_port_arrays(
+  struct a2j_stream * stream_ptr);
 
 struct a2j_port *
 a2j_find_port_by_addr(
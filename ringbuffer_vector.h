@@ -0,0 +1,82 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * ALSA SEQ < - > JACK MIDI bridge
+ *
+ * Copyright (c) 2026 The a2jmidid authors
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ */
+
+#ifndef RINGBUFFER_VECTOR_H__E8F49FE4_EC7C_49CA_9574_9423FFE2C6E9__INCLUDED
+#define RINGBUFFER_VECTOR_H__E8F49FE4_EC7C_49CA_9574_9423FFE2C6E9__INCLUDED
+
+/* Events are copied between the two segments of a jack_ringbuffer
+ * read or write vector and the JACK or ALSA buffers directly, the
+ * read or write pointer is moved once for all of them. Used by jack.c
+ * and by bench_ring, which times these copies against the old peek
+ * reads. */
+
+/* copy size bytes out of a ringbuffer read vector and move the vector past them, dst NULL just skips them */
+static
+inline
+void
+a2j_read_vector_copy(
+  jack_ringbuffer_data_t * vec,
+  void * dst,
+  size_t size)
+{
+  size_t limit;
+
+  limit = size > vec[0].len ? vec[0].len : size;
+  if (limit) {
+    if (dst)
+      memcpy(dst, vec[0].buf, limit);
+    vec[0].buf += limit;
+    vec[0].len -= limit;
+  }
+
+  if (size > limit) {
+    if (dst)
+      memcpy((char *)dst + limit, vec[1].buf, size - limit);
+    vec[1].buf += size - limit;
+    vec[1].len -= size - limit;
+  }
+}
+
+/* copy size bytes into a ringbuffer write vector and move the vector past them */
+static
+inline
+void
+a2j_write_vector_copy(
+  jack_ringbuffer_data_t * vec,
+  const void * src,
+  size_t size)
+{
+  size_t limit;
+
+  limit = size > vec[0].len ? vec[0].len : size;
+  if (limit) {
+    memcpy(vec[0].buf, src, limit);
+    vec[0].buf += limit;
+    vec[0].len -= limit;
+  }
+
+  if (size > limit) {
+    memcpy(vec[1].buf, (const char *)src + limit, size - limit);
+    vec[1].buf += size - limit;
+    vec[1].len -= size - limit;
+  }
+}
+
+#endif /* #ifndef RINGBUFFER_VECTOR_H__E8F49FE4_EC7C_49CA_9574_9423FFE2C6E9__INCLUDED */
@@ -0,0 +1,113 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * ALSA SEQ < - > JACK MIDI bridge
+ *
+ * Copyright (c) 2026 The a2jmidid authors
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ */
+
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/mman.h>
+
+#include "slab.h"
+#include "log.h"
+
+#define A2J_SLAB_ALIGN 64       /* cache line */
+
+bool
+a2j_slab_init(
+  struct a2j_slab * slab_ptr,
+  size_t object_size,
+  unsigned int capacity,
+  bool lock)
+{
+  void * base;
+
+  slab_ptr->stride = (object_size + A2J_SLAB_ALIGN - 1) & ~((size_t)A2J_SLAB_ALIGN - 1);
+
+  /* only address space, pages are committed as slots get used */
+  base = mmap(NULL, slab_ptr->stride * capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (base == MAP_FAILED)
+  {
+    a2j_error("Failed to reserve %u slots of %zu bytes: %s", capacity, slab_ptr->stride, strerror(errno));
+    slab_ptr->base = NULL;
+    return false;
+  }
+
+  slab_ptr->base = base;
+  slab_ptr->capacity = capacity;
+  slab_ptr->used = 0;
+  slab_ptr->free = NULL;
+  slab_ptr->lock = lock;
+
+  return true;
+}
+
+void
+a2j_slab_uninit(
+  struct a2j_slab * slab_ptr)
+{
+  if (slab_ptr->base != NULL)
+  {
+    munmap(slab_ptr->base, slab_ptr->stride * slab_ptr->capacity);
+    slab_ptr->base = NULL;
+  }
+}
+
+/* zeroed object, or NULL when all slots are in use */
+void *
+a2j_slab_alloc(
+  struct a2j_slab * slab_ptr)
+{
+  void * object;
+
+  if (slab_ptr->free != NULL)
+  {
+    object = slab_ptr->free;
+    slab_ptr->free = *(void **)object;
+  }
+  else if (slab_ptr->used < slab_ptr->capacity)
+  {
+    object = slab_ptr->base + (size_t)slab_ptr->used * slab_ptr->stride;
+
+    if (slab_ptr->lock && mlock(object, slab_ptr->stride) != 0)
+    {
+      a2j_warning("Cannot lock port memory, continuing unlocked: %s", strerror(errno));
+      slab_ptr->lock = false;
+    }
+
+    slab_ptr->used++;
+  }
+  else
+  {
+    return NULL;
+  }
+
+  /* also faults in the whole slot, before anybody else touches it */
+  memset(object, 0, slab_ptr->stride);
+
+  return object;
+}
+
+void
+a2j_slab_free(
+  struct a2j_slab * slab_ptr,
+  void * object)
+{
+  *(void **)object = slab_ptr->free;
+  slab_ptr->free = object;
+}
@@ -0,0 +1,59 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * ALSA SEQ < - > JACK MIDI bridge
+ *
+ * Copyright (c) 2026 The a2jmidid authors
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ */
+
+#ifndef SLAB_H__69142C5A_8DCE_4204_ADF5_9DF2D69019BC__INCLUDED
+#define SLAB_H__69142C5A_8DCE_4204_ADF5_9DF2D69019BC__INCLUDED
+
+/* Fixed size objects carved from one reserved address range. Slots are
+ * committed (and locked, if asked to) when first handed out and are
+ * recycled through a free list afterwards, they never go back to the
+ * system before a2j_slab_uninit(). Not thread safe, used by the main
+ * loop only. */
+struct a2j_slab
+{
+  char * base;
+  size_t stride;
+  unsigned int capacity;
+  unsigned int used;            /* slots handed out at least once */
+  void * free;                  /* recycled slots, linked through their first word */
+  bool lock;
+};
+
+bool
+a2j_slab_init(
+  struct a2j_slab * slab_ptr,
+  size_t object_size,
+  unsigned int capacity,
+  bool lock);
+
+void
+a2j_slab_uninit(
+  struct a2j_slab * slab_ptr);
+
+void *
+a2j_slab_alloc(
+  struct a2j_slab * slab_ptr);
+
+void
+a2j_slab_free(
+  struct a2j_slab * slab_ptr,
+  void * object);
+
+#endif /* #ifndef SLAB_H__69142C5A_8DCE_4204_ADF5_9DF2D69019BC__INCLUDED */
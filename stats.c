@@ -0,0 +1,76 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * ALSA SEQ < - > JACK MIDI bridge
+ *
+ * Copyright (c) 2026 The a2jmidid authors
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "stats.h"
+
+#define A2J_PORT_STATS_COUNTER(field) { # field, offsetof(struct a2j_port_stats, field) }
+
+const struct a2j_stats_counter g_a2j_port_stats_counters[A2J_PORT_STATS_COUNTERS] =
+{
+  A2J_PORT_STATS_COUNTER(events),
+  A2J_PORT_STATS_COUNTER(bytes),
+  A2J_PORT_STATS_COUNTER(dropped_ring_full),
+  A2J_PORT_STATS_COUNTER(dropped_jack_buffer),
+  A2J_PORT_STATS_COUNTER(late),
+  A2J_PORT_STATS_COUNTER(dropped_sysex),
+  A2J_PORT_STATS_COUNTER(dropped_too_large),
+  A2J_PORT_STATS_COUNTER(codec_errors),
+  A2J_PORT_STATS_COUNTER(output_errors),
+  A2J_PORT_STATS_COUNTER(ring_high_water),
+};
+
+void
+a2j_port_stats_read(
+  const struct a2j_port_stats * stats_ptr,
+  struct a2j_port_stats * snapshot_ptr)
+{
+  unsigned int i;
+  size_t offset;
+
+  for (i = 0; i < A2J_PORT_STATS_COUNTERS; i++)
+  {
+    offset = g_a2j_port_stats_counters[i].offset;
+    *(uint64_t *)((char *)snapshot_ptr + offset) = __atomic_load_n((const uint64_t *)((const char *)stats_ptr + offset), __ATOMIC_RELAXED);
+  }
+}
+
+void
+a2j_port_stats_accumulate(
+  struct a2j_port_stats * total_ptr,
+  const struct a2j_port_stats * stats_ptr)
+{
+  total_ptr->events += stats_ptr->events;
+  total_ptr->bytes += stats_ptr->bytes;
+  total_ptr->dropped_ring_full += stats_ptr->dropped_ring_full;
+  total_ptr->dropped_jack_buffer += stats_ptr->dropped_jack_buffer;
+  total_ptr->late += stats_ptr->late;
+  total_ptr->dropped_sysex += stats_ptr->dropped_sysex;
+  total_ptr->dropped_too_large += stats_ptr->dropped_too_large;
+  total_ptr->codec_errors += stats_ptr->codec_errors;
+  total_ptr->output_errors += stats_ptr->output_errors;
+
+  if (stats_ptr->ring_high_water > total_ptr->ring_high_water)
+  {
+    total_ptr->ring_high_water = stats_ptr->ring_high_water;
+  }
+}
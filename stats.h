@@ -0,0 +1,81 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * ALSA SEQ < - > JACK MIDI bridge
+ *
+ * Copyright (c) 2026 The a2jmidid authors
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ */
+
+#ifndef STATS_H__3C0F61D2_8B47_4E2A_9D15_6A7E2B90C4F8__INCLUDED
+#define STATS_H__3C0F61D2_8B47_4E2A_9D15_6A7E2B90C4F8__INCLUDED
+
+/* Counters are written with relaxed atomics by the thread that owns the
+ * event at that point and read at any time by the main loop. */
+
+struct a2j_port_stats
+{
+  uint64_t events;              /* delivered to JACK (capture) or to the sequencer (playback) */
+  uint64_t bytes;
+  uint64_t dropped_ring_full;   /* no room in the port ringbuffer */
+  uint64_t dropped_jack_buffer; /* capture: no room in the JACK port buffer */
+  uint64_t late;                /* capture: picked up after its delivery frame, placed at the cycle start */
+  uint64_t dropped_sysex;       /* no free SysEx buffer, capture: SysEx too large or not terminated */
+  uint64_t dropped_too_large;   /* playback: larger than --max-event-size */
+  uint64_t codec_errors;        /* events the MIDI codec could not convert */
+  uint64_t output_errors;       /* playback: rejected by the sequencer */
+  uint64_t ring_high_water;     /* most bytes ever queued in the port ringbuffer */
+};
+
+struct a2j_bridge_stats
+{
+  uint64_t port_events_dropped; /* port announcements lost, port_add ringbuffer full */
+  uint64_t drain_errors;        /* failed snd_seq_drain_output() calls */
+  struct a2j_port_stats retired[2]; /* totals of freed ports, per stream - main loop */
+};
+
+struct a2j_stats_counter
+{
+  const char * name;
+  size_t offset;
+};
+
+#define A2J_PORT_STATS_COUNTERS 10
+
+extern const struct a2j_stats_counter g_a2j_port_stats_counters[A2J_PORT_STATS_COUNTERS];
+
+#define A2J_STAT_ADD(counter, value) __atomic_fetch_add(&(counter), (value), __ATOMIC_RELAXED)
+#define A2J_STAT_INC(counter) A2J_STAT_ADD(counter, 1)
+
+/* single writer only */
+static inline void a2j_stat_high_water(uint64_t * counter_ptr, uint64_t value)
+{
+  if (value > __atomic_load_n(counter_ptr, __ATOMIC_RELAXED))
+  {
+    __atomic_store_n(counter_ptr, value, __ATOMIC_RELAXED);
+  }
+}
+
+void
+a2j_port_stats_read(
+  const struct a2j_port_stats * stats_ptr,
+  struct a2j_port_stats * snapshot_ptr);
+
+/* high water marks are merged with max, everything else is summed */
+void
+a2j_port_stats_accumulate(
+  struct a2j_port_stats * total_ptr,
+  const struct a2j_port_stats * stats_ptr);
+
+#endif /* #ifndef STATS_H__3C0F61D2_8B47_4E2A_9D15_6A7E2B90C4F8__INCLUDED */
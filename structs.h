@@ -25,46 +25,99 @@
 #include <semaphore.h>
 #include <jack/midiport.h>
 
+#include "histogram.h"
+#include "stats.h"
+#include "sysex.h"
+#include "slab.h"
+#include "clock_dll.h"
+#include "backend.h"
+
 #define JACK_INVALID_PORT NULL
 
 #define MAX_PORTS  2048
 #define MAX_EVENT_SIZE 1024
 
-#define PORT_HASH_BITS 4
-#define PORT_HASH_SIZE (1 << PORT_HASH_BITS)
+#define PORT_TABLE_CLIENTS 256 /* snd_seq_addr_t.client is unsigned char */
+#define PORT_TABLE_PORTS   256 /* snd_seq_addr_t.port is unsigned char */
 
-typedef struct a2j_port * a2j_port_hash_t[PORT_HASH_SIZE];
+typedef struct a2j_port ** a2j_port_table_t[PORT_TABLE_CLIENTS];
 
 struct a2j;
 
+/* jack_get_cycle_times() of the current cycle. jack process writes it
+ * under a sequence count that is odd while an update is in progress. */
+struct a2j_cycle_times
+{
+  unsigned int seq;             /* 0 until the first cycle */
+  jack_nframes_t frames;
+  jack_nframes_t nframes;
+  jack_time_t current_usecs;
+  jack_time_t next_usecs;
+};
+
 struct a2j_port
 {
-  struct a2j_port * next;       /* hash - jack */
   struct list_head siblings;    /* list - main loop */
   struct a2j * a2j_ptr;
+  struct a2j_slab * slab_ptr;   /* the port and its ringbuffer storage come from there */
   bool is_dead;
+  bool is_released;             /* removed from table and queued to port_del by jack process */
   snd_seq_addr_t remote;
   jack_port_t * jack_port;
+  snd_midi_event_t * codec;     /* keeps running status and SysEx state between events - ALSA thread of the port */
 
   jack_ringbuffer_t * inbound_events; // alsa_midi_event_t + data
+  struct a2j_sysex_buffer * sysex_assembly;   /* SysEx being reassembled - ALSA input thread */
+  struct a2j_sysex_buffer * sysex_pending[A2J_SYSEX_POOL_SIZE]; /* SysEx waiting for JACK buffer space - jack process */
+  unsigned int sysex_pending_head;
+  unsigned int sysex_pending_count;
+  size_t inbound_seen;          /* bytes of inbound_events already looked at in earlier cycles - jack process */
+  jack_nframes_t inbound_last_frame; /* of the last event queued to inbound_events - ALSA input thread */
+  bool inbound_last_valid;
+  jack_ringbuffer_t * outbound_events; // struct a2j_delivery_event + data
+  jack_ringbuffer_t events_ring; /* inbound_events or outbound_events, data is at the end of the slab slot */
+  bool out_queued;              /* head of outbound_events is in the merge heap - output thread */
+  unsigned char out_running_status; /* of channel messages converted by a2j_midi_encode_fast(), 0 if none - output thread */
+  bool out_encoder_stale;       /* a2j_midi_encode_fast() converted a status codec has not seen - output thread */
   int64_t last_out_time;
+  struct a2j_port_stats stats;
+  struct a2j_histogram latency; /* usecs, capture: ALSA arrival to JACK cycle position, playback: past the deadline */
+  jack_latency_range_t latency_range; /* reported to JACK, from the configured delay and latency - main loop, ports_lock */
 
   void * jack_buf;
   char name[0];
 };
 
-struct a2j_stream
+/* Snapshot of the stream port list, built by the main loop and read by
+ * jack process. Once published, an array is never modified; it is
+ * replaced by a new one and freed after jack process has picked up the
+ * replacement. */
+struct a2j_port_array
 {
-  snd_midi_event_t *codec;
+  struct a2j_port_array * retired_next; /* list - main loop */
+  unsigned int count;
+  struct a2j_port * ports[0];
+};
 
-  jack_ringbuffer_t *new_ports;
+struct a2j_stream
+{
+  struct a2j_slab port_slab;    /* ports with their ringbuffer data, see a2j_port_slab_init() */
+  size_t port_ring_size;
 
-  a2j_port_hash_t port_hash;
+  a2j_port_table_t port_table;
   struct list_head list;
+
+  struct a2j_port_array * active_ports;  /* published by main loop */
+  struct a2j_port_array * rt_ports;      /* last array picked up by jack process */
+  struct a2j_port_array * out_ports;     /* last array picked up by ALSA output thread (playback only) */
+  struct a2j_port_array * in_ports;      /* last array picked up by ALSA input thread, it looks up ports of both streams */
+  struct a2j_port_array * retired_ports; /* replaced arrays, waiting for jack process to move on */
+  bool ports_dirty;                      /* list changed but publishing failed */
 };
 
 struct a2j
 {
+  struct a2j_backend backend;   // what the JACK client and sequencer calls go to
   jack_client_t * jack_client;
 
   snd_seq_t *seq;
@@ -76,15 +129,58 @@ struct a2j
     
   jack_ringbuffer_t *port_add; // snd_seq_addr_t
   jack_ringbuffer_t *port_del; // struct a2j_port*
-  jack_ringbuffer_t * outbound_events; // struct a2j_delivery_event
+  struct list_head zombie_ports; // deleted ports, waiting for jack process to move on
+  pthread_mutex_t ports_lock;   // stream port lists, changed by main loop and ALSA input thread, read by the JACK latency callback
   jack_nframes_t cycle_start;
 
-  sem_t io_semaphore;
+  jack_nframes_t input_delay;   // frames from ALSA arrival to JACK delivery, written by jack process
+  jack_nframes_t input_delay_published; // last value reported to JACK, main loop
+  int32_t input_age_max;        // oldest new event in the adaptive window, INT32_MIN if none - jack process
+  unsigned int input_delay_cycles;
+  jack_nframes_t output_delay;  // frames from JACK time to ALSA delivery, written by jack process
+  jack_nframes_t output_delay_published; // last value reported to JACK, main loop
+  jack_time_t latency_updated;  // when the main loop last looked at the port latencies
+  bool latency_dirty;           // buffer size changed, port latencies need a fresh look
+
+  int io_eventfd;               // wakes the output thread: earlier event, new port array or stop
+  int io_timerfd;               // wakes the output thread at its next deadline
+  uint64_t out_next_frame;      // frame of the next output deadline, A2J_OUTPUT_IDLE if none
+
+  struct a2j_sysex_pool sysex_pool;
+  struct a2j_sysex_pool sysex_out_pool; // playback events larger than MAX_EVENT_SIZE
+
+  struct a2j_cycle_times cycle_times; // published by jack process for the ALSA input thread
+  struct a2j_clock_dll input_clock; // ALSA queue real time -> JACK time, ALSA input thread
+  jack_time_t input_clock_sampled;
+
+  /* page faults of the jack process thread with --lock-memory, sampled by the main loop */
+  pid_t rt_tid;                 // set by the JACK thread init callback, 0 until then
+  bool rt_faults_sampled;       // rt_minflt_start and rt_majflt_start are valid
+  unsigned long rt_minflt_start;
+  unsigned long rt_majflt_start;
+
+  struct a2j_bridge_stats stats;
+  struct a2j_trace * trace;     // NULL unless recording with --trace
+  struct a2j_histogram output_lateness; // usecs past the deadline, written by the output thread
 
   struct a2j_stream stream[2];
 };
 
+#define A2J_OUTPUT_IDLE UINT64_MAX
+
+#define A2J_CLOCK_SAMPLE_USECS 100000  /* how often the input thread correlates queue and JACK time */
+#define A2J_CLOCK_SAMPLE_MAX_USECS 200 /* samples that took longer are discarded */
+
+#define A2J_INPUT_DELAY_WINDOW_CYCLES 1024 /* adaptive input delay shrinks at most this often */
+#define A2J_INPUT_DELAY_MARGIN_FRACTION 8  /* headroom over the oldest event seen, in parts of a period */
+#define A2J_INPUT_DELAY_MAX_PERIODS 4      /* adaptive input delay never grows past this */
+
+#define A2J_LATENCY_UPDATE_USECS 1000000 /* how often port latencies reported to JACK follow the measurements */
+#define A2J_LATENCY_PERCENTILE 99        /* the reported maximum ignores the slowest events above it */
+#define A2J_LATENCY_HYSTERESIS_FRACTION 8 /* measured changes up to this part of the reported value are ignored */
+
 #define NSEC_PER_SEC ((int64_t)1000*1000*1000)
+#define NSEC_PER_USEC ((int64_t)1000)
 
 struct a2j_process_info
 {
@@ -100,24 +196,32 @@ struct a2j_alsa_midi_event
 {
   int64_t time;
   int size;
+  struct a2j_sysex_buffer * sysex; /* holds the data if not NULL, otherwise it follows in the ringbuffer */
 };
 
-#define MAX_JACKMIDI_EV_SIZE 16
+#define MAX_OUTBOUND_EVENTS MAX_EVENT_SIZE /* per playback port */
+
+#define A2J_DEFAULT_MAX_OUTBOUND_EVENT_SIZE 32768 /* default for g_a2j_max_event_size */
+#define A2J_MAX_OUTBOUND_EVENT_SIZE_LIMIT (1024 * 1024) /* largest accepted --max-event-size, the SysEx pools hold A2J_SYSEX_POOL_SIZE each */
+
+#define A2J_KERNEL_POOL_OUTPUT 2000 /* kernel limit for client output pool */
 
 struct a2j_delivery_event 
 {
-  struct list_head siblings;
-
-  /* a jack MIDI event, plus the port its destined for: everything
-     the ALSA output thread needs to deliver the event. time is
-     part of the jack_event.
+  /* header of a jack MIDI event queued for the ALSA output thread,
+     size bytes of MIDI data follow it in outbound_events unless the
+     event is larger than MAX_EVENT_SIZE and came in a pooled buffer
   */
-  jack_midi_event_t jack_event;
   jack_nframes_t time; /* realtime, not offset time */
+  uint32_t size;
   struct a2j_port* port;
-  char midistring[MAX_JACKMIDI_EV_SIZE];
+  struct a2j_sysex_buffer * sysex; /* from sysex_out_pool, NULL if the data follows */
 };
 
+/* outbound_events size: room for MAX_OUTBOUND_EVENTS short messages and one MAX_EVENT_SIZE event */
+#define A2J_OUTBOUND_EVENTS_SIZE \
+  (MAX_OUTBOUND_EVENTS * (sizeof(struct a2j_delivery_event) + 3) + sizeof(struct a2j_delivery_event) + MAX_EVENT_SIZE)
+
 /* Beside enum use, these are indeces for (struct a2j).stream array */
 #define A2J_PORT_CAPTURE   0 // ALSA playback port -> JACK capture port
 #define A2J_PORT_PLAYBACK  1 // JACK playback port -> ALSA capture port
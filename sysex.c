@@ -0,0 +1,110 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * ALSA SEQ < - > JACK MIDI bridge
+ *
+ * Copyright (c) 2026 The a2jmidid authors
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <jack/midiport.h>
+
+#include "sysex.h"
+#include "log.h"
+
+/* buffers are kept pointer aligned inside the pool block */
+#define A2J_SYSEX_BUFFER_STRIDE(capacity) \
+  ((sizeof(struct a2j_sysex_buffer) + (capacity) + sizeof(void *) - 1) & ~(sizeof(void *) - 1))
+
+bool
+a2j_sysex_pool_init(
+  struct a2j_sysex_pool * pool_ptr,
+  unsigned int count,
+  size_t capacity,
+  bool lock)
+{
+  size_t stride;
+  unsigned int i;
+
+  stride = A2J_SYSEX_BUFFER_STRIDE(capacity);
+
+  pool_ptr->memory = malloc(count * stride);
+  if (pool_ptr->memory == NULL)
+  {
+    a2j_error("Failed to allocate %u SysEx buffers of %zu bytes", count, capacity);
+    return false;
+  }
+
+  if (lock && mlock(pool_ptr->memory, count * stride) != 0)
+  {
+    a2j_warning("Cannot lock SysEx buffers, continuing unlocked: %s", strerror(errno));
+  }
+
+  pool_ptr->capacity = capacity;
+  pool_ptr->free = NULL;
+
+  for (i = 0; i < count; i++)
+  {
+    a2j_sysex_put(pool_ptr, (struct a2j_sysex_buffer *)((char *)pool_ptr->memory + i * stride));
+  }
+
+  return true;
+}
+
+void
+a2j_sysex_pool_uninit(
+  struct a2j_sysex_pool * pool_ptr)
+{
+  free(pool_ptr->memory);
+  pool_ptr->memory = NULL;
+  pool_ptr->free = NULL;
+}
+
+/* the one thread that takes buffers from the pool only */
+struct a2j_sysex_buffer *
+a2j_sysex_get(
+  struct a2j_sysex_pool * pool_ptr)
+{
+  struct a2j_sysex_buffer * buffer_ptr;
+
+  buffer_ptr = __atomic_load_n(&pool_ptr->free, __ATOMIC_ACQUIRE);
+  while (buffer_ptr != NULL &&
+         !__atomic_compare_exchange_n(&pool_ptr->free, &buffer_ptr, buffer_ptr->next, false, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE))
+  {
+  }
+
+  if (buffer_ptr != NULL)
+  {
+    buffer_ptr->size = 0;
+  }
+
+  return buffer_ptr;
+}
+
+/* any thread, including jack process */
+void
+a2j_sysex_put(
+  struct a2j_sysex_pool * pool_ptr,
+  struct a2j_sysex_buffer * buffer_ptr)
+{
+  buffer_ptr->next = __atomic_load_n(&pool_ptr->free, __ATOMIC_RELAXED);
+  while (!__atomic_compare_exchange_n(&pool_ptr->free, &buffer_ptr->next, buffer_ptr, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+  {
+  }
+}
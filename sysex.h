@@ -0,0 +1,65 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * ALSA SEQ < - > JACK MIDI bridge
+ *
+ * Copyright (c) 2026 The a2jmidid authors
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ */
+
+#ifndef SYSEX_H__07F67458_7FD6_4DC1_A6B9_25594E2F4D7D__INCLUDED
+#define SYSEX_H__07F67458_7FD6_4DC1_A6B9_25594E2F4D7D__INCLUDED
+
+#define A2J_SYSEX_POOL_SIZE 16
+
+/* SysEx that does not fit in one inbound_events record is reassembled in one of these */
+struct a2j_sysex_buffer
+{
+  struct a2j_sysex_buffer * next; /* free list link */
+  size_t size;
+  jack_midi_data_t data[0];
+};
+
+/* Buffers of a pool are taken by one thread only, the ALSA input thread
+ * for capture SysEx and jack process for playback SysEx, and given back
+ * by any thread, so the free list is a lock-free stack without ABA
+ * problems. */
+struct a2j_sysex_pool
+{
+  struct a2j_sysex_buffer * free;
+  size_t capacity;
+  void * memory;
+};
+
+bool
+a2j_sysex_pool_init(
+  struct a2j_sysex_pool * pool_ptr,
+  unsigned int count,
+  size_t capacity,
+  bool lock);
+
+void
+a2j_sysex_pool_uninit(
+  struct a2j_sysex_pool * pool_ptr);
+
+struct a2j_sysex_buffer *
+a2j_sysex_get(
+  struct a2j_sysex_pool * pool_ptr);
+
+void
+a2j_sysex_put(
+  struct a2j_sysex_pool * pool_ptr,
+  struct a2j_sysex_buffer * buffer_ptr);
+
+#endif /* #ifndef SYSEX_H__07F67458_7FD6_4DC1_A6B9_25594E2F4D7D__INCLUDED */
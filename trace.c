@@ -0,0 +1,259 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * ALSA SEQ < - > JACK MIDI bridge
+ *
+ * Copyright (c) 2026 The a2jmidid authors
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <alsa/asoundlib.h>
+#include <jack/jack.h>
+#include <jack/ringbuffer.h>
+
+#include "trace.h"
+#include "log.h"
+
+struct a2j_trace *
+a2j_trace_open(
+  const char * path,
+  uint32_t sample_rate,
+  uint32_t buffer_size,
+  uint32_t input_delay,
+  bool lock)
+{
+  struct a2j_trace * trace_ptr;
+  struct a2j_trace_header header;
+  unsigned int i;
+
+  trace_ptr = calloc(1, sizeof(struct a2j_trace));
+  if (trace_ptr == NULL)
+  {
+    a2j_error("calloc() failed to allocate trace");
+    goto fail;
+  }
+
+  for (i = 0; i < 2; i++)
+  {
+    trace_ptr->rings[i] = jack_ringbuffer_create(A2J_TRACE_RING_SIZE);
+    if (trace_ptr->rings[i] == NULL)
+    {
+      a2j_error("jack_ringbuffer_create() failed for trace");
+      goto free_rings;
+    }
+
+    if (lock)
+    {
+      jack_ringbuffer_mlock(trace_ptr->rings[i]);
+    }
+  }
+
+  trace_ptr->file = fopen(path, "wb");
+  if (trace_ptr->file == NULL)
+  {
+    a2j_error("Cannot open trace file \"%s\": %s", path, strerror(errno));
+    goto free_rings;
+  }
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, A2J_TRACE_MAGIC, sizeof(header.magic));
+  header.version = A2J_TRACE_VERSION;
+  header.sample_rate = sample_rate;
+  header.buffer_size = buffer_size;
+  header.input_delay = input_delay;
+
+  if (fwrite(&header, sizeof(header), 1, trace_ptr->file) != 1)
+  {
+    a2j_error("Cannot write trace file \"%s\": %s", path, strerror(errno));
+    goto close_file;
+  }
+
+  a2j_info("Recording trace to \"%s\"", path);
+
+  return trace_ptr;
+
+close_file:
+  fclose(trace_ptr->file);
+
+free_rings:
+  for (i = 0; i < 2; i++)
+  {
+    if (trace_ptr->rings[i] != NULL)
+    {
+      jack_ringbuffer_free(trace_ptr->rings[i]);
+    }
+  }
+
+  free(trace_ptr);
+
+fail:
+  return NULL;
+}
+
+static
+void
+a2j_trace_push(
+  struct a2j_trace * trace_ptr,
+  unsigned int thread,
+  struct a2j_trace_record * record_ptr,
+  const void * data,
+  size_t data_size)
+{
+  jack_ringbuffer_t * ring;
+
+  ring = trace_ptr->rings[thread];
+
+  if (jack_ringbuffer_write_space(ring) < sizeof(struct a2j_trace_record) + data_size)
+  {
+    __atomic_fetch_add(&trace_ptr->lost[thread], 1, __ATOMIC_RELAXED);
+    return;
+  }
+
+  record_ptr->usecs = jack_get_time();
+
+  jack_ringbuffer_write(ring, (const char *)record_ptr, sizeof(struct a2j_trace_record));
+  if (data_size > 0)
+  {
+    jack_ringbuffer_write(ring, data, data_size);
+  }
+}
+
+void
+a2j_trace_cycle(
+  struct a2j_trace * trace_ptr,
+  uint32_t frame,
+  uint32_t nframes,
+  uint32_t input_delay)
+{
+  struct a2j_trace_record record;
+
+  memset(&record, 0, sizeof(record));
+  record.frame = frame;
+  record.size = nframes;
+  record.type = A2J_TRACE_CYCLE;
+  record.input_delay = input_delay;
+
+  a2j_trace_push(trace_ptr, A2J_TRACE_PROCESS_THREAD, &record, NULL, 0);
+}
+
+void
+a2j_trace_record(
+  struct a2j_trace * trace_ptr,
+  unsigned int thread,
+  uint8_t type,
+  uint32_t frame,
+  const snd_seq_addr_t * addr_ptr,
+  const void * data,
+  uint32_t size)
+{
+  struct a2j_trace_record record;
+
+  memset(&record, 0, sizeof(record));
+  record.frame = frame;
+  record.size = size;
+  record.type = type;
+  record.client = addr_ptr->client;
+  record.port = addr_ptr->port;
+
+  a2j_trace_push(trace_ptr, thread, &record, data, size);
+}
+
+/* header and data are written separately, only complete records are moved to the file */
+static
+void
+a2j_trace_write_ring(
+  struct a2j_trace * trace_ptr,
+  jack_ringbuffer_t * ring)
+{
+  struct a2j_trace_record record;
+  jack_ringbuffer_data_t vec[2];
+  size_t len;
+  size_t limit;
+
+  while (jack_ringbuffer_peek(ring, (char *)&record, sizeof(record)) == sizeof(record))
+  {
+    len = sizeof(record) + (record.type == A2J_TRACE_CYCLE ? 0 : record.size);
+    if (jack_ringbuffer_read_space(ring) < len)
+    {
+      break;
+    }
+
+    jack_ringbuffer_get_read_vector(ring, vec);
+    limit = len > vec[0].len ? vec[0].len : len;
+
+    if (fwrite(vec[0].buf, limit, 1, trace_ptr->file) != 1 ||
+        (len > limit && fwrite(vec[1].buf, len - limit, 1, trace_ptr->file) != 1))
+    {
+      a2j_error("Cannot write trace: %s", strerror(errno));
+    }
+
+    jack_ringbuffer_read_advance(ring, len);
+  }
+}
+
+void
+a2j_trace_flush(
+  struct a2j_trace * trace_ptr)
+{
+  struct a2j_trace_record record;
+  uint64_t lost;
+  unsigned int i;
+
+  for (i = 0; i < 2; i++)
+  {
+    a2j_trace_write_ring(trace_ptr, trace_ptr->rings[i]);
+
+    lost = __atomic_load_n(&trace_ptr->lost[i], __ATOMIC_RELAXED);
+    if (lost != trace_ptr->lost_reported[i])
+    {
+      memset(&record, 0, sizeof(record));
+      record.usecs = jack_get_time();
+      record.type = A2J_TRACE_LOST;
+      record.size = lost - trace_ptr->lost_reported[i];
+      fwrite(&record, sizeof(record), 1, trace_ptr->file);
+      trace_ptr->lost_reported[i] = lost;
+    }
+  }
+}
+
+void
+a2j_trace_close(
+  struct a2j_trace * trace_ptr)
+{
+  unsigned int i;
+
+  a2j_trace_flush(trace_ptr);
+
+  if (trace_ptr->lost_reported[A2J_TRACE_INPUT_THREAD] + trace_ptr->lost_reported[A2J_TRACE_PROCESS_THREAD] != 0)
+  {
+    a2j_warning(
+      "Trace buffer overflowed, %llu records lost",
+      (unsigned long long)(trace_ptr->lost_reported[A2J_TRACE_INPUT_THREAD] + trace_ptr->lost_reported[A2J_TRACE_PROCESS_THREAD]));
+  }
+
+  fclose(trace_ptr->file);
+
+  for (i = 0; i < 2; i++)
+  {
+    jack_ringbuffer_free(trace_ptr->rings[i]);
+  }
+
+  free(trace_ptr);
+}
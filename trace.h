@@ -0,0 +1,110 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*
+ * ALSA SEQ < - > JACK MIDI bridge
+ *
+ * Copyright (c) 2026 The a2jmidid authors
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ */
+
+#ifndef TRACE_H__A41E6F0B_2D7C_4C93_8E5A_1F9B07D3C268__INCLUDED
+#define TRACE_H__A41E6F0B_2D7C_4C93_8E5A_1F9B07D3C268__INCLUDED
+
+/* Trace file: a struct a2j_trace_header followed by struct a2j_trace_record
+ * entries, each followed by its MIDI bytes. Records of the ALSA input
+ * thread and of jack process are written in separate batches, sort them
+ * by usecs to get the order they happened in. Host byte order. */
+
+#define A2J_TRACE_MAGIC "A2JTRACE"
+#define A2J_TRACE_VERSION 2     /* version 1 had no input delay, it was one period */
+
+#define A2J_TRACE_CYCLE  1 /* jack process started, frame is the cycle start, size the period, input_delay applied in it */
+#define A2J_TRACE_INPUT  2 /* ALSA event reached the input thread, frame is the JACK frame assigned to it */
+#define A2J_TRACE_OUTPUT 3 /* JACK event queued for ALSA, frame is when it is due */
+#define A2J_TRACE_LOST   4 /* size records were lost because the trace buffer was full */
+
+struct a2j_trace_header
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t sample_rate;
+  uint32_t buffer_size;
+  uint32_t input_delay;         /* --input-delay frames, or one of the values below */
+};
+
+#define A2J_TRACE_INPUT_DELAY_PERIOD   0
+#define A2J_TRACE_INPUT_DELAY_ADAPTIVE UINT32_MAX
+
+struct a2j_trace_record
+{
+  uint64_t usecs;               /* jack_get_time() when recorded */
+  uint32_t frame;
+  uint32_t size;                /* bytes of MIDI data following, frames for cycles */
+  uint8_t type;
+  uint8_t client;               /* ALSA address of the port, events only */
+  uint8_t port;
+  uint8_t reserved;
+  uint32_t input_delay;         /* cycles: frames between ALSA arrival and JACK delivery */
+};
+
+#define A2J_TRACE_INPUT_THREAD 0
+#define A2J_TRACE_PROCESS_THREAD 1
+
+#define A2J_TRACE_RING_SIZE (1024 * 1024) /* per recording thread */
+
+/* each recording thread has its own ringbuffer, the main loop writes them to the file */
+struct a2j_trace
+{
+  FILE * file;
+  jack_ringbuffer_t * rings[2];
+  uint64_t lost[2];             /* written by the recording thread */
+  uint64_t lost_reported[2];    /* main loop */
+};
+
+struct a2j_trace *
+a2j_trace_open(
+  const char * path,
+  uint32_t sample_rate,
+  uint32_t buffer_size,
+  uint32_t input_delay,
+  bool lock);
+
+/* realtime safe, drops the record if there is no room */
+void
+a2j_trace_cycle(
+  struct a2j_trace * trace_ptr,
+  uint32_t frame,
+  uint32_t nframes,
+  uint32_t input_delay);
+
+/* realtime safe, drops the record if there is no room */
+void
+a2j_trace_record(
+  struct a2j_trace * trace_ptr,
+  unsigned int thread,
+  uint8_t type,
+  uint32_t frame,
+  const snd_seq_addr_t * addr_ptr,
+  const void * data,
+  uint32_t size);
+
+void
+a2j_trace_flush(
+  struct a2j_trace * trace_ptr);
+
+void
+a2j_trace_close(
+  struct a2j_trace * trace_ptr);
+
+#endif /* #ifndef TRACE_H__A41E6F0B_2D7C_4C93_8E5A_1F9B07D3C268__INCLUDED */